@@ -0,0 +1,59 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novabat.h
+Purpose: Header file for running a script on a pool of workers, split into chunks whose results are gathered back in order.
+*/
+
+#ifndef NOVABAT_H
+#define NOVABAT_H
+
+//Necessary imports.
+#include<stdint.h>
+#include<stdatomic.h>
+#include<pthread.h>
+#include"novapipe.h"
+#include"novacmp.h"
+#include"novaexe.h"
+
+//Chunks made for each worker, so that a worker done early can take another, and the fewest bytes worth a chunk of their own.
+#define BATCH_CHUNKS_PER_WORKER 4
+#define BATCH_CHUNK_MIN (64 * 1024)
+
+//A part of the script that ends at a line end, with a pipeline of its own. Only the worker that takes the chunk steps its stages.
+struct chunk_t {
+	struct buffer_t *in_buf;
+	struct buffer_t *parse_buf;
+	struct buffer_t *out_buf;
+	struct context_queue_t *context_queue;
+	struct execute_stack_t *execute_stack;
+	struct parse_t *parse;
+	struct interpret_t *interpret;
+	struct execute_t *execute;
+};
+
+//Struct for a script split into chunks, the workers that run them, and the output buffer their results are gathered into.
+struct batch_t {
+	struct buffer_t *in_buf;
+	struct buffer_t *out_buf;
+	struct chunk_t **chunks;
+	uint64_t num_chunks;
+	_Atomic uint64_t next_chunk;
+	int num_workers;
+	int num_started;
+	pthread_t *workers;
+};
+
+//Prototypes for batches.
+struct batch_t *batch_create(struct buffer_t *, struct buffer_t *, uint64_t, char, int);
+void batch_destroy(struct batch_t **);
+char batch_start(struct batch_t *);
+void batch_join(struct batch_t *);
+void *do_batch(void *);
+void *do_gather(void *);
+
+//Prototypes for chunks.
+struct chunk_t *chunk_create(void *, uint64_t, uint64_t, char, uint64_t);
+void chunk_destroy(struct chunk_t **);
+
+#endif
@@ -16,17 +16,30 @@ Purpose: Header file for the language specification.
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
+#include<stdint.h>
+#include<stdatomic.h>
 
-struct dictionary_t {
-	unsigned char **dict;
-	unsigned char num_alpha;
-	unsigned char num_rules;
+//Characters that end a statement. The input node turns line ends into null characters, but a mapped script file still has its own.
+#define NOVA_STATEMENT_END(c) ((c) == '\0' || (c) == '\n' || (c) == '\r')
+
+//A grammar table the parser runs on: the one Nova is built with, or one compiled by novagen and loaded from a file.
+//A parser holds on to its table until the end of the statement it is on, so a loaded table that has been replaced is kept on a list of retired tables until Nova ends.
+struct lang_table_t {
+	uint32_t num_rules;
+	uint32_t num_classes;
+	const unsigned char *classes;
+	const unsigned char *next;
+	const unsigned char *context;
+	const unsigned char *digit_loop;
+	struct lang_table_t *retired;
 };
+
 //A struct for parsing data.
 struct parse_t {
 	struct buffer_t *in_buf;
 	struct buffer_t *out_buf;
 	struct context_queue_t *context_queue;
+	struct lang_table_t *table;
 	//uint64_t current_rule;
 	//uint64_t rule_count;
 	//uint64_t prod_count;
@@ -36,17 +49,31 @@ struct parse_t {
 	unsigned char last_context;
 	unsigned char current_prod;
 	//char next_prod;
+	//Characters carried from one pass to the next: the current one, one held back for its look ahead, and the look ahead.
+	int current;
+	int last;
+	int look_ahead;
+	//Set while a fused pass runs alongside the parser, which then stops at the end of each statement to hand back to it.
+	//Held is set while the fused pass waits for room in the output, so that the parser waits with it rather than take the next statement.
+	char fused;
+	char held;
 	char cont_flag;
-	struct dictionary_t *dict;
 };
 
 //A struct for generating nova instructions.
+//The statement being read is compiled into code as its records complete. An operator waits for the number after it, and at most one number is left for it to take.
+//Completed statements are queued for the executor straight away, but pending of them are only counted as ready in batches.
+//Malformed is set once the statement being read has been marked as holding a grammar error.
 struct interpret_t {
 	struct buffer_t *in_buf;
 	struct context_queue_t *context_queue;
 	struct execute_stack_t *execute_stack;
-	struct execute_stack_t *back_stack;
-	struct execute_element_t *current_element;
+	struct execute_code_t *code;
+	int literal;
+	unsigned char op;
+	char operands;
+	char malformed;
+	uint64_t pending;
 	uint64_t current_count;
 	uint64_t current_type;
 	uint64_t current_size;
@@ -54,6 +81,11 @@ struct interpret_t {
 	char cont_flag;
 };
 
+//Function prototypes for grammar tables.
+struct lang_table_t *lang_table_load(const char *);
+void lang_table_swap(struct lang_table_t *);
+void lang_table_release();
+
 //Function prototypes for parsing.
 struct parse_t *parse_create();
 void parse_destroy(struct parse_t **);
@@ -61,6 +93,7 @@ struct buffer_t *parse_set_in(struct parse_t *, struct buffer_t *);
 struct buffer_t *parse_set_out(struct parse_t *, struct buffer_t *);
 struct context_queue_t *parse_set_queue(struct parse_t *, struct context_queue_t *);
 void *do_parse(void *);
+char parse_step(struct parse_t *);
 
 //Function prototypes for interpreting.
 struct interpret_t *interpret_create();
@@ -70,7 +103,13 @@ struct context_queue_t *interpret_set_queue(struct interpret_t *, struct context
 struct execute_stack_t *interpret_set_stack(struct interpret_t *, struct execute_stack_t *);
 //void interpret_elements_resize(struct interpret_t *, uint64_t new_size);
 void *do_interpret(void *);
+char interpret_step(struct interpret_t *);
+
+//Function prototypes for the fused path, which evaluates simple statements straight from the input.
+char fuse_step(struct parse_t *, struct interpret_t *, struct execute_t *);
 
 //Function prototypes for conversion from console text to something usable by the execution environment.
 void console_to_int(struct interpret_t *, int *);
+char console_literal(struct interpret_t *, const char *, uint64_t);
+int console_digits(const char *, uint64_t, uint32_t *);
 #endif
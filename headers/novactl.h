@@ -0,0 +1,89 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novactl.h
+Purpose: Header file for the runtime configuration of Nova and the controller that adapts the pipeline to its load.
+*/
+
+#ifndef NOVACTL_H
+#define NOVACTL_H
+
+//Necessary imports.
+#include<stdio.h>
+#include<stdint.h>
+#include<stdatomic.h>
+#include<pthread.h>
+#include"novapipe.h"
+#include"novaout.h"
+
+//Defaults for the configuration. Buffers start small for interactive use and grow under load.
+#define CONTROL_BUFFER_SIZE 1024
+#define CONTROL_BUFFER_MIN 1024
+#define CONTROL_BUFFER_MAX (16 * 1024 * 1024)
+#define CONTROL_INTERVAL 100
+#define CONTROL_FLUSH_LATENCY 1000
+#define CONTROL_WORKERS 1
+#define CONTROL_WORKERS_LIMIT 1024
+
+//Number of quiet intervals in a row before a buffer is shrunk, and the share of its size below which the traffic through a buffer in an interval counts as quiet.
+//Also the most buffers the controller watches.
+#define CONTROL_SHRINK_INTERVALS 50
+#define CONTROL_IDLE_FRACTION 8
+#define CONTROL_MAX_BUFFERS 16
+
+//Longest name of the shared memory rings, which get .in and .out added to it.
+#define CONTROL_SHM_NAME_SIZE (BUFFER_NAME_SIZE - 5)
+
+//Longest path of the socket to serve sessions on, as limited by the socket address.
+#define CONTROL_PATH_SIZE 108
+
+//Longest line read from a configuration file, and the environment variable naming the file.
+#define CONTROL_LINE_SIZE 256
+#define CONTROL_ENV_FILE "NOVA_CONFIG"
+
+//Longest path of a grammar table file, which is no longer than a configuration line.
+#define CONTROL_GRAMMAR_SIZE CONTROL_LINE_SIZE
+
+//A buffer watched by the controller, with the telemetry seen at the last interval.
+struct control_buffer_t {
+	struct buffer_t *buf;
+	struct buffer_stats_t last;
+	uint32_t quiet;
+};
+//Struct for the runtime configuration and the controller thread that acts on it.
+struct control_t {
+	uint64_t buffer_size;
+	uint64_t buffer_min;
+	uint64_t buffer_max;
+	uint64_t interval;
+	uint64_t flush_latency;
+	char output_format;
+	int workers;
+	char adaptive;
+	char input_block;
+	char shm[CONTROL_SHM_NAME_SIZE];
+	char shm_producer;
+	char listen[CONTROL_PATH_SIZE];
+	char grammar[CONTROL_GRAMMAR_SIZE];
+	_Atomic char cont_flag;
+	pthread_mutex_t lock;
+	struct control_buffer_t buffers[CONTROL_MAX_BUFFERS];
+	int num_buffers;
+};
+
+//Prototypes for configuration.
+struct control_t *control_create();
+void control_destroy(struct control_t **);
+char control_set(struct control_t *, const char *, const char *);
+char control_load_file(struct control_t *, const char *);
+char control_load_env(struct control_t *);
+int control_parse_args(struct control_t *, int, char **);
+void control_usage(FILE *, const char *);
+
+//Prototypes for the controller.
+char control_add_buffer(struct control_t *, struct buffer_t *);
+void control_step(struct control_t *);
+void control_stop(struct control_t *);
+void *do_control(void *);
+
+#endif
@@ -10,33 +10,132 @@ Purpose: Defines functions that are executed on the c-level as well as the mecha
 
 //Necessary imports.
 #include"novapipe.h"
+#include"novawait.h"
+#include"novaout.h"
+#include"novaslab.h"
 #include<stdlib.h>
 
+//Most bytes one result takes as text, with its line end, and how many results are gathered to be formatted as one block.
+#define EXECUTE_RESULT_SIZE OUTPUT_INT_SIZE
+#define EXECUTE_BATCH_SIZE 64
+
+//Room for a full batch in either format. A binary record is wider than the longest text result.
+#define EXECUTE_BLOCK_SIZE OUTPUT_FRAME_SIZE(EXECUTE_BATCH_SIZE)
+
+//Instructions a statement is compiled to. A push is followed by its number as an int in the byte order of the machine, and the rest stand alone.
+//Operators apply to the two numbers on top and leave one, and an end gives the number on top as a result. Zero is no instruction, for an operator not yet placed.
+#define EXECUTE_OP_PUSH 1
+#define EXECUTE_OP_ADD 2
+#define EXECUTE_OP_SUB 3
+#define EXECUTE_OP_END 4
+
+//Marks the results of a statement from there on as those of a malformed statement.
+#define EXECUTE_OP_MALFORMED 5
+
+//Operators taking a literal as their second number rather than one pushed before them, with an int after them or one byte for a small number.
+#define EXECUTE_OP_ADD_LITERAL 6
+#define EXECUTE_OP_SUB_LITERAL 7
+#define EXECUTE_OP_ADD_SMALL 8
+#define EXECUTE_OP_SUB_SMALL 9
+
+//A number from zero up to the largest small one is pushed by a single byte tagged with the top bit, holding the number in the rest.
+#define EXECUTE_OP_SMALL 0x80
+#define EXECUTE_SMALL_MAX 0x7F
+
+//Bytes first set aside for the code of a statement, and the most numbers its code holds at once.
+#define EXECUTE_CODE_SIZE 64
+#define EXECUTE_OPERANDS 2
+
+//The executor jumps from each instruction straight to the next through a table of labels where the compiler has them, and goes through a switch otherwise.
+#if defined(__GNUC__) && !defined(NOVA_NO_THREADED)
+#define EXECUTE_THREADED
+#endif
+
+//Types of an element holding the code of a statement, on the heap or in the element itself, and the most bytes of code an element holds.
+#define EXECUTE_TYPE_CODE 3
+#define EXECUTE_TYPE_INLINE 4
+#define EXECUTE_INLINE_SIZE 48
+
+//Slots a ring backed stack starts with. It doubles when full, so it is always a power of two.
+#define EXECUTE_STACK_SLOTS 64
+
 //Struct for the execution header.
+//A node stepped by a shared worker may not wait for room in its output, so formatted results that do not fit are set aside in the spill until there is.
 struct execute_t {
 	struct execute_stack_t *stack;
-	struct execute_stack_t *back_stack;
+	struct buffer_t *out_buf;
+	int results[EXECUTE_BATCH_SIZE];
+	uint64_t sequences[EXECUTE_BATCH_SIZE];
+	int statuses[EXECUTE_BATCH_SIZE];
+	uint64_t num_results;
+	char format;
+	uint64_t first;
+	uint64_t fused;
+	uint64_t count;
+	char *spill;
+	uint64_t spill_read;
+	uint64_t spill_size;
+	uint64_t spill_capacity;
+	char stepped;
 	char cont_flag;
 };
 
+//The code of a statement, run from start to end in one go. It grows as it is compiled, and is handed to the executor whole.
+//The start of the last instruction is kept so that an operator can be folded into the push before it.
+struct execute_code_t {
+	uint64_t size;
+	uint64_t capacity;
+	uint64_t last;
+	unsigned char ops[];
+};
+
 //Structs for the execution queue.
+//Each element holds the code of a statement. Elements are all one size and own nothing but heap code, so short code is kept inline in place of the pointer to it.
 struct execute_element_t {
-	void *value;
+	union {
+		void *value;
+		unsigned char ops[EXECUTE_INLINE_SIZE];
+	};
 	struct execute_element_t *next;
+	uint32_t size;
 	char type_id;
 };
+//The stack also counts the statements the interpreter has completed on it, which the executor waits on. Once closed, no more statements are coming.
+//The count is a sequence that only grows, raised by a batch of statements at a time, and the executor runs everything up to the count it sees before looking again.
+//Completed statements are added under the bottom, so the executor runs them in order from the top.
+//A stack is either a locked list of elements, or a ring of element slots starting at head when it has slots. Elements are copied in and out of the slots, so that a ring takes no allocation per element and is read in order through memory.
 struct execute_stack_t {	
 	pthread_mutex_t lock;
-	pthread_cond_t exe_wait;
 	struct execute_element_t *top;
+	struct execute_element_t *bottom;
+	struct execute_element_t *slots;
+	uint64_t head;
+	uint64_t count;
+	uint64_t capacity;
+	char locked;
+	_Atomic uint64_t ready;
+	_Atomic char closed;
+	struct wait_t wait;
 };
 
 //Functions for execution control.
 struct execute_t *execute_create();
 void execute_destroy(struct execute_t **);
 struct execute_stack_t *execute_set_stack(struct execute_t *, struct execute_stack_t *);
+struct buffer_t *execute_set_out(struct execute_t *, struct buffer_t *);
+char execute_set_format(struct execute_t *, char);
+uint64_t execute_set_first(struct execute_t *, uint64_t);
 void *do_execute(void *);
-void nova_run(struct execute_stack_t *, struct execute_stack_t *, struct execute_element_t *);
+char execute_step(struct execute_t *);
+char execute_fused(struct execute_t *, int);
+void execute_report_slabs(FILE *);
+void execute_release_slabs();
+
+//Functions for compiled code.
+struct execute_code_t *execute_code_create(uint64_t);
+void execute_code_destroy(struct execute_code_t *);
+char execute_code_emit(struct execute_code_t **, unsigned char, int);
+void execute_code_run(struct execute_t *, const unsigned char *, uint64_t);
 
 //Helper methods.
 //String to integer converter.
@@ -47,12 +146,19 @@ void nova_run(struct execute_stack_t *, struct execute_stack_t *, struct execute
 //void execute_params_destroy(struct execute_params_t **);
 //struct execute_queue_t *execute_queue_create();
 //void execute_queue_destroy(struct execute_queue_t **);
-struct execute_element_t *execute_element_create(size_t, char);
+void execute_element_set_code(struct execute_element_t *, struct execute_code_t **);
+void execute_element_clear(struct execute_element_t *);
 void execute_element_destroy(struct execute_element_t **);
 struct execute_element_t *execute_stack_pop(struct execute_stack_t *);
 struct execute_element_t *execute_stack_peek(struct execute_stack_t *);
 void execute_stack_push(struct execute_stack_t *, struct execute_element_t *);
+void execute_stack_enqueue(struct execute_stack_t *, struct execute_element_t *);
+char execute_stack_enqueue_value(struct execute_stack_t *, const struct execute_element_t *);
+char execute_stack_pop_value(struct execute_stack_t *, struct execute_element_t *);
+void execute_stack_publish(struct execute_stack_t *, uint64_t);
+void execute_stack_close(struct execute_stack_t *);
 struct execute_stack_t *execute_stack_create();
+struct execute_stack_t *execute_stack_create_array(char);
 void execute_stack_destroy(struct execute_stack_t **);
 //void execute_enqueue(struct execute_queue_t *, struct execute_element_t *);
 //struct execute_element_t *execute_dequeue(struct execute_queue_t *);
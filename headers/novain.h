@@ -14,11 +14,16 @@ Purpose: Header file for the input functions and elements.
 #include<pthread.h>
 #include"novapipe.h"
 
+//Input modes. Character mode reads one character at a time through stdio, and block mode reads whole blocks from the file descriptor straight into the buffer.
+#define INPUT_MODE_CHAR 0
+#define INPUT_MODE_BLOCK 1
+
 //struct to store input variables.
 struct input_t {
 	FILE *in_file;
 	struct buffer_t *out_buf;
 	pthread_mutex_t lock;
+	char mode;
 	char cont_flag;
 };
 
@@ -27,6 +32,7 @@ struct input_t *input_create();
 void input_destroy(struct input_t **);
 FILE *input_set_in(struct input_t *, FILE *);
 struct buffer_t *input_set_out(struct input_t *, struct buffer_t *);
+char input_set_mode(struct input_t *, char);
 void *do_in(void *);
 
 #endif
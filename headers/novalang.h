@@ -0,0 +1,73 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novalang.h
+Purpose: The grammar of the Nova language, and the format of the tables it is compiled into. The grammar is compiled into the tables Nova is built with, and nothing here is read at run time apart from the table format.
+*/
+
+#ifndef NOVALANG_H
+#define NOVALANG_H
+
+//Necessary imports.
+#include<stdint.h>
+
+//Constants that define language.
+#define NUM_NOVA_LANG_ALPHA 13
+#define NUM_NOVA_LANG_STR_LEN 13
+#define NUM_NOVA_LANG_PRODS 93
+#define NUM_NOVA_LANG_RULES 5
+
+#define NOVA_CHAR_LEN 1
+#define NOVA_RULE_LEN 3
+#define NOVA_ARROW_LEN 4
+#define NOVA_DELIMIT_LEN 2
+
+//Markers for the rule that ends a statement and for no rule at all.
+#define NOVA_LANG_TERM 254
+#define NOVA_LANG_EMPTY 255
+
+//Largest context a rule can append: numbers are 0, operators 1, and statement ends 2.
+#define NOVA_LANG_CONTEXT_MAX 2
+
+//A compiled grammar table as novagen writes it to a file and a running parser loads it. Numbers are little-endian.
+//The header is followed by the class of every byte, then the next rules indexed by (rule * classes + character class) * classes + look ahead class, then the context of every rule, then whether every rule loops on digits.
+//Rule zero is where a statement starts. Rules are below the end marker, and the last class is the one for characters outside the language.
+#define NOVA_TABLE_MAGIC "NOVATAB1"
+#define NOVA_TABLE_MAGIC_LEN 8
+#define NOVA_TABLE_MAX_RULES NOVA_LANG_TERM
+#define NOVA_TABLE_MAX_CLASSES 256
+#define NOVA_TABLE_SIZE(rules, classes) (sizeof(struct nova_table_header_t) + 256 + (uint64_t)(rules) * (classes) * (classes) + 2 * (uint64_t)(rules))
+
+struct nova_table_header_t {
+	char magic[NOVA_TABLE_MAGIC_LEN];
+	uint32_t num_rules;
+	uint32_t num_classes;
+};
+
+//The characters of the language, in ascending order.
+static const char NOVA_LANG_ALPHA[] = "+-0123456789;";
+
+//The static human readable repersentation of the language grammar. Each item here is a string that represents a production in the grammar in the format: 
+//starting rule (numerical char) -> (produces) character (ASCII char), (delimiter) next rule (numerical char).
+static const char NOVA_LANG_PRODS[NUM_NOVA_LANG_PRODS][NUM_NOVA_LANG_STR_LEN] = {
+	"000 -> 0, 001", "000 -> 1, 001", "000 -> 2, 001", "000 -> 3, 001", "000 -> 4, 001", "000 -> 5, 001", "000 -> 6, 001", "000 -> 7, 001", "000 -> 8, 001", "000 -> 9, 001", "000 -> -, 002", 
+	"000 -> +, 002", "000 -> 1, 003", "000 -> 2, 003", "000 -> 3, 003", "000 -> 4, 003", "000 -> 5, 003", "000 -> 6, 003", "000 -> 7, 003", "000 -> 8, 003", "000 -> 9, 003", "000 -> 0, 004",
+	"000 -> 1, 004", "000 -> 2, 004", "000 -> 3, 004", "000 -> 4, 004", "000 -> 5, 004", "000 -> 6, 004", "000 -> 7, 004", "000 -> 8, 004", "000 -> 9, 004",
+	
+	"001 -> ;, 254",
+
+	"002 -> 0, 001", "002 -> 1, 001", "002 -> 2, 001", "002 -> 3, 001", "002 -> 4, 001", "002 -> 5, 001", "002 -> 6, 001", "002 -> 7, 001", "002 -> 8, 001", "002 -> 9, 001", "002 -> 1, 003", 
+	"002 -> 2, 003", "002 -> 3, 003", "002 -> 4, 003", "002 -> 5, 003", "002 -> 6, 003", "002 -> 7, 003", "002 -> 8, 003", "002 -> 9, 003", "002 -> 0, 004", "002 -> 1, 004", "002 -> 2, 004", 
+	"002 -> 3, 004", "002 -> 4, 004", "002 -> 5, 004", "002 -> 6, 004", "002 -> 7, 004", "002 -> 8, 004", "002 -> 9, 004",
+
+	"003 -> 0, 001", "003 -> 1, 001", "003 -> 2, 001", "003 -> 3, 001", "003 -> 4, 001", "003 -> 5, 001", "003 -> 6, 001", "003 -> 7, 001", "003 -> 8, 001", "003 -> 9, 001", "003 -> 0, 003",
+	"003 -> 1, 003", "003 -> 2, 003", "003 -> 3, 003", "003 -> 4, 003", "003 -> 5, 003", "003 -> 6, 003", "003 -> 7, 003", "003 -> 8, 003", "003 -> 9, 003", "003 -> 0, 004", "003 -> 1, 004",
+	"003 -> 2, 004", "003 -> 3, 004", "003 -> 4, 004", "003 -> 5, 004", "003 -> 6, 004", "003 -> 7, 004", "003 -> 8, 004", "003 -> 9, 004",
+
+	"004 -> -, 000", "004 -> +, 000"
+};
+
+//The context each rule appends when the parser enters it.
+static const unsigned char NOVA_LANG_CONTEXT[NUM_NOVA_LANG_RULES] = {0, 2, 0, 0, 1};
+
+#endif
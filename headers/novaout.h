@@ -14,11 +14,41 @@ Purpose: Header file for the output functions and elements.
 #include<pthread.h>
 #include"novapipe.h"
 
+//Most characters an integer result takes as text, with its sign and line end.
+#define OUTPUT_INT_SIZE 12
+
+//Formats results go out in. Text is a decimal per line. Binary is a stream of frames, each a header followed by fixed width records, all little-endian.
+#define OUTPUT_FORMAT_TEXT 0
+#define OUTPUT_FORMAT_BINARY 1
+
+//Status of a result record. A result of a statement the parser found a grammar error in is still given, but marked as malformed.
+#define OUTPUT_STATUS_OK 0
+#define OUTPUT_STATUS_MALFORMED 1
+
+//Bytes a binary frame takes for the given number of records.
+#define OUTPUT_FRAME_SIZE(count) (sizeof(struct output_frame_t) + (count) * sizeof(struct output_record_t))
+
+//Header of a binary frame. The length counts the bytes of records after the header, so that a reader can take a frame whole and use the records in place.
+struct output_frame_t {
+	uint32_t length;
+	uint32_t count;
+};
+//A binary result record, numbered by the statement it came from, counting from 1.
+struct output_record_t {
+	uint64_t sequence;
+	int32_t value;
+	int32_t status;
+};
+
+//Default bound, in microseconds, on how long output is held back to be written together with what follows it.
+#define OUTPUT_LATENCY 1000
+
 //Struct to store output variables.
 struct output_t {
 	FILE *out_file;
 	struct buffer_t *in_buf;
 	pthread_mutex_t lock;
+	uint64_t latency;
 	char cont_flag;
 };
 
@@ -27,6 +57,12 @@ struct output_t *output_create();
 void output_destroy(struct output_t **);
 struct buffer_t *output_set_in(struct output_t *, struct buffer_t *);
 FILE *output_set_out(struct output_t *, FILE *);
+uint64_t output_set_latency(struct output_t *, uint64_t);
 void *do_out(void *);
 
+//Prototypes for formatting results.
+uint64_t output_format_int(char *, int);
+uint64_t output_format_ints(char *, const int *, uint64_t);
+uint64_t output_format_frame(char *, const int *, const uint64_t *, const int *, uint64_t);
+
 #endif
@@ -12,15 +12,78 @@ Purpose: A header to define Nova application pipeline elements and functions.
 #include<stdlib.h>
 #include<stdio.h>
 #include<stdint.h>
+#include<stdatomic.h>
 #include<pthread.h>
+#include<sys/uio.h>
+#include"novawait.h"
+
+//Buffer synchronization modes. Locked buffers gatekeep both cursors with the buffer mutex, SPSC buffers are lock-free between exactly one writer and one reader thread.
+#define BUFFER_MODE_LOCKED 0
+#define BUFFER_MODE_SPSC 1
+
+//Cache line size used to keep the writer and reader sides of a buffer apart.
+#define BUFFER_CACHE_LINE 64
+
+//Number of buckets in the occupancy histogram of a buffer, and the most buffers that can be registered by name.
+#define BUFFER_STAT_BUCKETS 8
+#define BUFFER_REGISTRY_SIZE 32
+#define BUFFER_NAME_SIZE 32
+
+//Marks the control block of a ring in shared memory as initialized.
+#define BUFFER_RING_MAGIC 0x4e4f564152494e47ULL
+
+//Number of records in a context queue. Must be a power of two.
+#define CONTEXT_QUEUE_SIZE 4096
 
 //Pipeline structs.
+//Telemetry kept by one side of a buffer. Only that side writes the counters, so they are cheap to keep up, but any thread may read them.
+//The size is the capacity of the region the side is on, as the buffer may be resized while in use.
+struct buffer_stat_t {
+	_Atomic uint64_t size;
+	_Atomic uint64_t bytes;
+	_Atomic uint64_t locks;
+	_Atomic uint64_t wakes;
+	_Atomic uint64_t handshakes;
+	_Atomic uint64_t occupancy[BUFFER_STAT_BUCKETS];
+};
+//A snapshot of the telemetry of a whole buffer. Stalls are waits for space or data, and sleeps are the stalls that ended up parked.
+struct buffer_stats_t {
+	uint64_t size;
+	uint64_t bytes_written;
+	uint64_t bytes_read;
+	uint64_t write_locks;
+	uint64_t read_locks;
+	uint64_t writer_stalls;
+	uint64_t reader_stalls;
+	uint64_t writer_sleeps;
+	uint64_t reader_sleeps;
+	uint64_t writer_wakes;
+	uint64_t reader_wakes;
+	uint64_t handshakes;
+	uint64_t occupancy[BUFFER_STAT_BUCKETS];
+};
+//The part of a buffer shared by its writer and its reader: the published positions, the waiting sites, and whether the writer has closed it.
+//A buffer normally holds its own. One attached to shared memory uses the control block at the start of the shared region instead, so that its two sides can be in different processes.
+struct buffer_ring_t {
+	_Atomic uint64_t magic;
+	uint64_t size;
+	_Atomic char closed;
+	_Alignas(BUFFER_CACHE_LINE) _Atomic uint64_t pos_write;
+	_Alignas(BUFFER_CACHE_LINE) _Atomic uint64_t pos_read;
+
+	//Waiting policy for a writer that finds the buffer full, and for a reader that finds it empty.
+	_Alignas(BUFFER_CACHE_LINE) struct wait_t wait_write;
+	_Alignas(BUFFER_CACHE_LINE) struct wait_t wait_read;
+};
 //Struct for the buffers between the pipeline stages. Is a circular buffer with a read and a write cursor.
+//In SPSC mode the cursors are published through monotonically increasing positions, and each side keeps a cached copy of the other side's position on its own cache line.
+//A mirrored buffer maps the same memory twice back to back, so that every readable or writable region is contiguous and spans never stop at the end.
+//A buffer can also wrap a read-only mapping of a file, or memory borrowed from elsewhere, which start out full and closed, or a ring in named shared memory. Once the writer closes a buffer the reader drains it and stops.
+//An SPSC buffer can be resized while in use. The writer moves on to a new region at pos_switch, and the reader keeps its own view of the old region until it has read up to there.
 struct buffer_t {
+	struct buffer_ring_t *ring;
 	void *memory;
 	void *end;
-	void *cursor_read;
-	void *cursor_write;
 	uint64_t size;
 	pthread_mutex_t lock;
 	pthread_cond_t cond_write;
@@ -28,41 +91,107 @@ struct buffer_t {
 	unsigned char num_sleeping_writers;
 	unsigned char num_sleeping_readers;
 	char wait;
-	char state;
+	_Atomic char state;
+	char mode;
+	char mirror;
+	char mapped;
+	char borrowed;
+	char shared;
+	char name[BUFFER_NAME_SIZE];
+	char shared_name[BUFFER_NAME_SIZE];
+
+	//Resizing. A requested size is taken up by the writer, and switch_pending stays set until the reader has moved to the new region.
+	_Atomic uint64_t resize;
+	_Atomic char switch_pending;
+	uint64_t pos_switch;
+
+	//Writer side.
+	_Alignas(BUFFER_CACHE_LINE) void *cursor_write;
+	uint64_t cache_read;
+	struct buffer_stat_t stat_write;
+
+	//Reader side.
+	_Alignas(BUFFER_CACHE_LINE) void *cursor_read;
+	uint64_t cache_write;
+	void *memory_read;
+	void *end_read;
+	uint64_t size_read;
+	struct buffer_stat_t stat_read;
+
+	//The buffer's own shared part, unless it is attached to shared memory.
+	struct buffer_ring_t ring_local;
 };
-//A struct to establish context for each element discovered during parsing. This is put on a stack shared between the parser and the interpreter.
+//A compact record to establish context for each element discovered during parsing. Records live in a ring shared between the parser and the interpreter and are recycled in place.
+//The size of the newest record grows while the parser is still on that element, so it is atomic. The type is only valid once the record is complete.
+//Failed is set on a record the parser found a grammar error in, so that the statement it is part of can be reported as malformed.
 struct context_element_t {
-	struct context_element_t *next;
-	struct context_element_t *back;
+	_Atomic uint64_t size;
 	uint64_t start;
-	uint64_t size;
 	uint64_t read;
-	char complete;
 	char type;
+	char failed;
 };
+//The ring of context records. The parser owns the newest record at head, which is always open, and the interpreter owns the oldest at tail.
+//Every record before head is complete. Each side keeps its index on its own cache line.
 struct context_queue_t {
-	pthread_mutex_t lock;
-	struct context_element_t *start;
-	struct context_element_t *end;
+	struct context_element_t *ring;
+	uint64_t mask;
+
+	//Parser side.
+	_Alignas(BUFFER_CACHE_LINE) _Atomic uint64_t head;
+	uint64_t cache_tail;
+
+	//Interpreter side.
+	_Alignas(BUFFER_CACHE_LINE) _Atomic uint64_t tail;
 };
 
 //Function prototypes.
 //Protypes for manipulating the buffers.
 struct buffer_t *buffer_create(uint64_t);
+struct buffer_t *buffer_create_spsc(uint64_t);
+struct buffer_t *buffer_create_mirror(uint64_t);
+struct buffer_t *buffer_create_file(const char *);
+struct buffer_t *buffer_create_view(void *, uint64_t);
+struct buffer_t *buffer_create_shared(const char *, uint64_t, char);
 void buffer_destroy(struct buffer_t **);
 void buffer_write_lock(struct buffer_t *);
 void buffer_write_unlock(struct buffer_t *, uint64_t);
 void buffer_read_lock(struct buffer_t *);
 void buffer_read_unlock(struct buffer_t *, uint64_t);
+uint64_t buffer_write_span(struct buffer_t *);
+uint64_t buffer_read_span(struct buffer_t *);
+void *buffer_reserve(struct buffer_t *, uint64_t);
+void buffer_commit(struct buffer_t *, uint64_t);
+void *buffer_peek(struct buffer_t *, uint64_t);
+void buffer_consume(struct buffer_t *, uint64_t);
+void *buffer_try_reserve(struct buffer_t *, uint64_t);
+void *buffer_try_peek(struct buffer_t *);
+void *buffer_peek_timed(struct buffer_t *, uint64_t, uint64_t);
+int buffer_read_vec(struct buffer_t *, struct iovec *);
+void buffer_put(struct buffer_t *, const void *, uint64_t);
+void buffer_close(struct buffer_t *);
+char buffer_drained(struct buffer_t *);
+char buffer_resize(struct buffer_t *, uint64_t);
+char buffer_resizable(struct buffer_t *);
+
+//Prototypes for buffer telemetry.
+char buffer_register(struct buffer_t *, const char *);
+void buffer_unregister(struct buffer_t *);
+struct buffer_t *buffer_find(const char *);
+void buffer_stats(struct buffer_t *, struct buffer_stats_t *);
+void buffer_report(FILE *, struct buffer_t *);
+void buffer_report_all(FILE *);
 
 //Queue functions for context.
 struct context_queue_t *context_queue_create();
 void context_queue_destroy(struct context_queue_t **);
-struct context_element_t *context_element_create();
-void context_element_destroy(struct context_element_t **);
+char context_reserve(struct context_queue_t *, uint64_t);
 void context_append(struct context_queue_t *, uint64_t);
 char context_remove(struct context_queue_t *);
+char context_complete(struct context_queue_t *);
 void context_increment(struct context_queue_t *, uint64_t);
+void context_fail(struct context_queue_t *);
+char context_failed(struct context_queue_t *);
 void context_read_inc(struct context_queue_t *, uint64_t);
 uint64_t context_type(struct context_queue_t *);
 uint64_t context_read(struct context_queue_t *);
@@ -0,0 +1,76 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novaslab.h
+Purpose: Header file for the slab allocator that hands out small objects of one size from per-thread caches.
+*/
+
+#ifndef NOVASLAB_H
+#define NOVASLAB_H
+
+//Necessary imports.
+#include<stdio.h>
+#include<stdint.h>
+#include<stddef.h>
+#include<stdatomic.h>
+#include<pthread.h>
+
+//Objects carved from each block taken from the system, and how many freed objects a thread keeps before it hands them on as a full magazine.
+#define SLAB_CHUNK_OBJECTS 256
+#define SLAB_MAGAZINE_SIZE 512
+
+//Initializer for a slab of objects of the given size, so that a slab can be a global with nothing to set up. Its thread key is made on first use.
+#define SLAB_INITIALIZER(object_size) {.size = (object_size), .lock = PTHREAD_MUTEX_INITIALIZER}
+
+//Every object is preceded by the magazine of the thread that last took it, padded so the object is aligned for any type. A free object holds the next free one in its place, so the object starts at next.
+struct slab_node_t {
+	union {
+		struct slab_magazine_t *owner;
+		max_align_t align;
+	};
+	struct slab_node_t *next;
+};
+
+//The cache of one thread. Objects it frees go on its own list without any atomics, and objects it took that another thread frees are pushed on its remote list, which it takes whole once its own runs out.
+//A magazine outlives its thread. It is left to the next thread that needs one, with whatever it still holds, and only freed with the slab.
+struct slab_magazine_t {
+	struct slab_node_t *free;
+	uint64_t num_free;
+	_Atomic(struct slab_node_t *) remote;
+	char *carve;
+	char *carve_end;
+	struct slab_t *slab;
+	struct slab_magazine_t *next;
+	struct slab_magazine_t *next_orphan;
+};
+
+//A full magazine's worth of freed objects handed on by a thread that frees more than it takes, for any thread to take.
+struct slab_depot_t {
+	struct slab_node_t *free;
+	struct slab_depot_t *next;
+};
+
+//Struct for a slab of objects of one size. The lock covers the blocks taken from the system, the depot, and the lists of magazines. The depot may be looked at without it to see whether it is empty.
+//Live counts the objects out now, peak the most that were out at once, and recycled the objects handed out again after being freed.
+struct slab_t {
+	uint64_t size;
+	pthread_mutex_t lock;
+	pthread_key_t key;
+	_Atomic char ready;
+	void *chunks;
+	_Atomic(struct slab_depot_t *) depot;
+	struct slab_magazine_t *magazines;
+	struct slab_magazine_t *orphans;
+	_Atomic uint64_t live;
+	_Atomic uint64_t peak;
+	_Atomic uint64_t recycled;
+	_Atomic uint64_t remote_frees;
+};
+
+//Prototypes for slabs.
+void *slab_alloc(struct slab_t *);
+void slab_free(struct slab_t *, void *);
+void slab_release(struct slab_t *);
+void slab_report(FILE *, const char *, struct slab_t *);
+
+#endif
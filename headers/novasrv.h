@@ -0,0 +1,74 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novasrv.h
+Purpose: Header file for the server that runs many Nova sessions over a Unix domain socket on a fixed pool of workers.
+*/
+
+#ifndef NOVASRV_H
+#define NOVASRV_H
+
+//Necessary imports.
+#include<stdint.h>
+#include<pthread.h>
+#include"novapipe.h"
+#include"novacmp.h"
+#include"novaexe.h"
+
+//Longest socket path, as limited by the socket address, and how many connections may wait to be accepted.
+#define SERVER_PATH_SIZE 108
+#define SERVER_BACKLOG 128
+
+//Most passes over a session's pipeline before its worker hands it back and moves on, so that one busy client cannot hold a worker.
+#define SERVER_SESSION_PASSES 16
+
+//States of a session's input. The client may stop sending, and then the input is ended once the last statement has its end.
+#define SESSION_INPUT_OPEN 0
+#define SESSION_INPUT_EOF 1
+#define SESSION_INPUT_CLOSED 2
+
+//A client connection with a pipeline of its own. The stages are stepped by whichever worker holds the session, and only one does at a time.
+struct session_t {
+	int fd;
+	struct buffer_t *in_buf;
+	struct buffer_t *parse_buf;
+	struct buffer_t *out_buf;
+	struct context_queue_t *context_queue;
+	struct execute_stack_t *execute_stack;
+	struct parse_t *parse;
+	struct interpret_t *interpret;
+	struct execute_t *execute;
+	char input_state;
+	char last;
+	struct session_t *prev;
+	struct session_t *next;
+};
+
+//Struct for the server, its sessions, and the workers that serve them.
+struct server_t {
+	int listen_fd;
+	int epoll_fd;
+	int stop_fd;
+	uint64_t buffer_size;
+	char format;
+	int num_workers;
+	pthread_t *workers;
+	int started;
+	pthread_mutex_t lock;
+	struct session_t *sessions;
+	uint64_t num_sessions;
+	char path[SERVER_PATH_SIZE];
+};
+
+//Prototypes for the server.
+struct server_t *server_create(const char *, uint64_t, char, int);
+void server_destroy(struct server_t **);
+char server_start(struct server_t *);
+void server_stop(struct server_t *);
+void *do_serve(void *);
+
+//Prototypes for sessions.
+struct session_t *session_create(int, uint64_t, char);
+void session_destroy(struct session_t **);
+
+#endif
@@ -0,0 +1,52 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novawait.h
+Purpose: Header file for the waiting policy used by the pipeline stages when they run out of work.
+*/
+
+#ifndef NOVAWAIT_H
+#define NOVAWAIT_H
+
+//Necessary imports.
+#include<stdio.h>
+#include<stdint.h>
+#include<stdatomic.h>
+
+//Bounds for the number of pause iterations spent spinning before yielding, and the number of yields before parking.
+#define WAIT_SPIN_MIN 16
+#define WAIT_SPIN_MAX 8192
+#define WAIT_YIELD_ROUNDS 4
+
+//Phases that can resolve a wait.
+#define WAIT_PHASE_SPIN 0
+#define WAIT_PHASE_YIELD 1
+#define WAIT_PHASE_PARK 2
+#define WAIT_NUM_PHASES 3
+
+//A check run while waiting. Returns 1 once the waiter can continue.
+typedef char (*wait_ready_t)(void *);
+
+//Struct for one waiting site. A single side waits on it, and the other side wakes it after publishing work.
+//The futex word is an event counter bumped on every wake, and parked tells the waking side whether the futex needs a system call.
+//A shared waiting site may sit in memory shared between processes, and uses futex operations that work across them.
+struct wait_t {
+	_Atomic uint32_t futex;
+	_Atomic uint32_t parked;
+	_Atomic uint32_t spin_limit;
+	_Atomic uint64_t resolved[WAIT_NUM_PHASES];
+	uint32_t shared;
+};
+
+//Prototypes for waiting.
+void wait_init(struct wait_t *);
+void wait_init_shared(struct wait_t *);
+char wait_spin(struct wait_t *, wait_ready_t, void *);
+void wait_park(struct wait_t *, wait_ready_t, void *);
+void wait_for(struct wait_t *, wait_ready_t, void *);
+char wait_for_timed(struct wait_t *, wait_ready_t, void *, uint64_t);
+char wait_wake(struct wait_t *);
+void wait_count(struct wait_t *, char);
+void wait_report(FILE *, const char *, struct wait_t *);
+
+#endif
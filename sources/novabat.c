@@ -0,0 +1,210 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novabat.c
+Purpose: Runs a script on a pool of workers. The script is split into chunks at line ends, each worker steps the pipelines of the chunks it takes, and the results are gathered back in the order of the chunks.
+*/
+
+//Necessary imports.
+#include"novabat.h"
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+
+//Private functions.
+void chunk_run(struct chunk_t *);
+uint64_t batch_count_statements(const char *, uint64_t);
+
+//Create a batch over the whole of a full and closed input buffer, such as a mapped script, gathering the results into the output buffer.
+//The script is cut into chunks for the given number of workers, each ending at a line end so that no statement is split. Each chunk gets buffers of the given size, and writes results in the given format.
+//Returns NULL if the batch cannot be set up.
+struct batch_t *batch_create(struct buffer_t *in_buf, struct buffer_t *out_buf, uint64_t buffer_size, char format, int num_workers) {
+	struct batch_t *ret_val = NULL;
+	if(in_buf != NULL && out_buf != NULL && num_workers > 0) ret_val = malloc(sizeof(struct batch_t));
+	if(ret_val != NULL) {
+		char *text = buffer_try_peek(in_buf);
+		uint64_t size = text != NULL ? buffer_read_span(in_buf) : 0;
+		uint64_t chunk_size = size / ((uint64_t)num_workers * BATCH_CHUNKS_PER_WORKER);
+		if(chunk_size < BATCH_CHUNK_MIN) chunk_size = BATCH_CHUNK_MIN;
+
+		//Every chunk but the last is at least the chunk size.
+		ret_val->in_buf = in_buf;
+		ret_val->out_buf = out_buf;
+		ret_val->chunks = malloc(sizeof(struct chunk_t *) * (size / chunk_size + 1));
+		ret_val->num_chunks = 0;
+		atomic_init(&ret_val->next_chunk, 0);
+		ret_val->num_started = 0;
+		ret_val->workers = NULL;
+		char valid = ret_val->chunks != NULL;
+
+		//Binary results carry the number of their statement across the whole script, so each chunk is told how many statements come before it.
+		uint64_t start = 0;
+		uint64_t first = 0;
+		while(valid && start < size) {
+			uint64_t end = start + chunk_size;
+			char *line_end = end < size ? memchr(text + end - 1, '\n', size - end + 1) : NULL;
+			end = line_end != NULL ? (uint64_t)(line_end - text) + 1 : size;
+			ret_val->chunks[ret_val->num_chunks] = chunk_create(text + start, end - start, buffer_size, format, first);
+			valid = ret_val->chunks[ret_val->num_chunks] != NULL;
+			if(valid) ++ret_val->num_chunks;
+			if(format == OUTPUT_FORMAT_BINARY) first += batch_count_statements(text + start, end - start);
+			start = end;
+		}
+
+		//There is no use in more workers than chunks.
+		ret_val->num_workers = (uint64_t)num_workers < ret_val->num_chunks ? num_workers : (int)ret_val->num_chunks;
+		if(valid && ret_val->num_workers > 0) {
+			ret_val->workers = malloc(sizeof(pthread_t) * ret_val->num_workers);
+			valid = ret_val->workers != NULL;
+		}
+		if(!valid) batch_destroy(&ret_val);
+	}
+	return ret_val;
+}
+
+//Destroys a batch and the pipelines of its chunks. The workers must have been joined. The input and output buffers are left to the caller.
+void batch_destroy(struct batch_t **batch) {
+	if(batch != NULL) {
+		if(*batch != NULL) {
+			if((*batch)->chunks != NULL) {
+				for(uint64_t count = 0; count < (*batch)->num_chunks; ++count) chunk_destroy(&(*batch)->chunks[count]);
+				free((*batch)->chunks);
+			}
+			if((*batch)->workers != NULL) free((*batch)->workers);
+			free(*batch);
+			*batch = NULL;
+		}
+	}
+}
+
+//Starts the workers. The chunks of a worker that cannot be started are taken by the others. Returns 1 if any worker was started, or if there is nothing to run.
+char batch_start(struct batch_t *batch) {
+	char ret_val = 0;
+	if(batch != NULL) {
+		for(int count = 0; count < batch->num_workers; ++count) {
+			if(pthread_create(&batch->workers[batch->num_started], NULL, do_batch, (void *)batch) == 0) ++batch->num_started;
+		}
+		ret_val = batch->num_started > 0 || batch->num_chunks == 0;
+	}
+	return ret_val;
+}
+
+//Waits for every started worker to run out of chunks.
+void batch_join(struct batch_t *batch) {
+	if(batch != NULL) {
+		for(int count = 0; count < batch->num_started; ++count) pthread_join(batch->workers[count], NULL);
+		batch->num_started = 0;
+	}
+}
+
+//Worker of a batch. Takes chunks in order until there are none left, and runs each to the end.
+void *do_batch(void *batch_ptr) {
+	if(batch_ptr != NULL) {
+		struct batch_t *batch = (struct batch_t *)batch_ptr;
+		uint64_t index = 0;
+		while((index = atomic_fetch_add_explicit(&batch->next_chunk, 1, memory_order_relaxed)) < batch->num_chunks) chunk_run(batch->chunks[index]);
+	}
+	pthread_exit(NULL);
+}
+
+//Gathers the results of the chunks into the output buffer in the order of the chunks, then closes it.
+//A chunk's results are copied out as they come, and the next chunk is started on once the last one is drained.
+void *do_gather(void *batch_ptr) {
+	if(batch_ptr != NULL) {
+		struct batch_t *batch = (struct batch_t *)batch_ptr;
+		for(uint64_t count = 0; count < batch->num_chunks; ++count) {
+			struct buffer_t *buf = batch->chunks[count]->out_buf;
+			while(1) {
+				buffer_peek(buf, 1);
+				if(buffer_drained(buf)) {
+					buffer_consume(buf, 0);
+					break;
+				}
+				uint64_t span = buffer_read_span(buf);
+				buffer_put(batch->out_buf, buf->cursor_read, span);
+				buffer_consume(buf, span);
+			}
+		}
+		buffer_close(batch->out_buf);
+	}
+	pthread_exit(NULL);
+}
+
+//Steps the pipeline of a chunk until its results have all been written.
+//A chunk ahead of the one being gathered fills its output buffer and has to wait for the gatherer to reach it. Nothing else holds it up, so a pass without progress waits for room.
+void chunk_run(struct chunk_t *chunk) {
+	while(chunk->execute->cont_flag) {
+		char progress = fuse_step(chunk->parse, chunk->interpret, chunk->execute);
+		progress |= parse_step(chunk->parse);
+		progress |= interpret_step(chunk->interpret);
+		progress |= execute_step(chunk->execute);
+		if(!progress) {
+			buffer_reserve(chunk->out_buf, OUTPUT_FRAME_SIZE(1));
+			buffer_commit(chunk->out_buf, 0);
+		}
+	}
+}
+
+//Counts the statements in a part of a script, which is how many runs of characters there are between statement ends.
+uint64_t batch_count_statements(const char *text, uint64_t size) {
+	uint64_t ret_val = 0;
+	char in_statement = 0;
+	for(uint64_t count = 0; count < size; ++count) {
+		char end = NOVA_STATEMENT_END(text[count]);
+		ret_val += !end && !in_statement;
+		in_statement = !end;
+	}
+	return ret_val;
+}
+
+//Creates the pipeline of a chunk over the given part of a script, with buffers of the given size. Its results are written in the given format, numbered after the given number of statements before it.
+//Returns NULL if any part of the pipeline cannot be had.
+struct chunk_t *chunk_create(void *text, uint64_t size, uint64_t buffer_size, char format, uint64_t first) {
+	struct chunk_t *ret_val = malloc(sizeof(struct chunk_t));
+	if(ret_val != NULL) {
+		ret_val->in_buf = buffer_create_view(text, size);
+		ret_val->parse_buf = buffer_create_mirror(buffer_size);
+		ret_val->out_buf = buffer_create_mirror(buffer_size);
+		ret_val->context_queue = context_queue_create();
+		ret_val->execute_stack = execute_stack_create_array(0);
+		ret_val->parse = parse_create();
+		ret_val->interpret = interpret_create();
+		ret_val->execute = execute_create();
+
+		//Make chunk creation atomic.
+		if(ret_val->in_buf == NULL || ret_val->parse_buf == NULL || ret_val->out_buf == NULL || ret_val->context_queue == NULL || ret_val->execute_stack == NULL || ret_val->parse == NULL || ret_val->interpret == NULL || ret_val->execute == NULL) chunk_destroy(&ret_val);
+		else {
+
+			//Wire up the pipeline the same way as the one run from standard input.
+			parse_set_in(ret_val->parse, ret_val->in_buf);
+			parse_set_out(ret_val->parse, ret_val->parse_buf);
+			parse_set_queue(ret_val->parse, ret_val->context_queue);
+			interpret_set_in(ret_val->interpret, ret_val->parse_buf);
+			interpret_set_queue(ret_val->interpret, ret_val->context_queue);
+			interpret_set_stack(ret_val->interpret, ret_val->execute_stack);
+			execute_set_stack(ret_val->execute, ret_val->execute_stack);
+			execute_set_out(ret_val->execute, ret_val->out_buf);
+			execute_set_format(ret_val->execute, format);
+			execute_set_first(ret_val->execute, first);
+		}
+	}
+	return ret_val;
+}
+
+//Destroys the pipeline of a chunk. The part of the script it ran over is left alone.
+void chunk_destroy(struct chunk_t **chunk) {
+	if(chunk != NULL) {
+		if(*chunk != NULL) {
+			parse_destroy(&(*chunk)->parse);
+			interpret_destroy(&(*chunk)->interpret);
+			execute_destroy(&(*chunk)->execute);
+			buffer_destroy(&(*chunk)->in_buf);
+			buffer_destroy(&(*chunk)->parse_buf);
+			buffer_destroy(&(*chunk)->out_buf);
+			context_queue_destroy(&(*chunk)->context_queue);
+			execute_stack_destroy(&(*chunk)->execute_stack);
+			free(*chunk);
+			*chunk = NULL;
+		}
+	}
+}
@@ -7,164 +7,130 @@ Purpose: Does the parsing for the Nova language.
 
 //Necessary imports.
 #include"novacmp.h"
+#include"novalang.h"
+#include"novatab.h"
+#include<sched.h>
+#include<endian.h>
+#ifdef __SSE2__
+#include<emmintrin.h>
+#endif
 
 //Private functions.
 void parse_through(struct parse_t *, uint64_t, uint64_t, int *, int *, int *, uint64_t *, uint64_t *);
+void parse_end(struct parse_t *);
+void parse_finish(struct parse_t *);
+uint64_t parse_count_digits(const char *, uint64_t);
+uint64_t fuse_statement(const char *, uint64_t, int *);
+char lang_table_valid(struct lang_table_t *);
 void interpret_in(struct interpret_t *, uint64_t, int *, uint64_t *);
-
-//Constants that define language.
-#define NUM_NOVA_LANG_ALPHA 13
-#define NUM_NOVA_LANG_STR_LEN 13
-#define NUM_NOVA_LANG_PRODS 93
-#define NUM_NOVA_LANG_RULES 5
-
-#define NOVA_CHAR_LEN 1
-#define NOVA_RULE_LEN 3
-#define NOVA_ARROW_LEN 4
-#define NOVA_DELIMIT_LEN 2
-
-#define NOVA_LANG_TERM 254
-#define NOVA_LANG_EMPTY 255
-
-const char *NOVA_LANG_ALPHA = "+-0123456789;";
-
-//The static human readable repersentation of the language grammar. Each item here is a string that represents a production in the grammar in the format: 
-//starting rule (numerical char) -> (produces) character (ASCII char), (delimiter) next rule (numerical char).
-const char NOVA_LANG_PRODS[NUM_NOVA_LANG_PRODS][NUM_NOVA_LANG_STR_LEN] = {
-	"000 -> 0, 001", "000 -> 1, 001", "000 -> 2, 001", "000 -> 3, 001", "000 -> 4, 001", "000 -> 5, 001", "000 -> 6, 001", "000 -> 7, 001", "000 -> 8, 001", "000 -> 9, 001", "000 -> -, 002", 
-	"000 -> +, 002", "000 -> 1, 003", "000 -> 2, 003", "000 -> 3, 003", "000 -> 4, 003", "000 -> 5, 003", "000 -> 6, 003", "000 -> 7, 003", "000 -> 8, 003", "000 -> 9, 003", "000 -> 0, 004",
-	"000 -> 1, 004", "000 -> 2, 004", "000 -> 3, 004", "000 -> 4, 004", "000 -> 5, 004", "000 -> 6, 004", "000 -> 7, 004", "000 -> 8, 004", "000 -> 9, 004",
-	
-	"001 -> ;, 254",
-
-	"002 -> 0, 001", "002 -> 1, 001", "002 -> 2, 001", "002 -> 3, 001", "002 -> 4, 001", "002 -> 5, 001", "002 -> 6, 001", "002 -> 7, 001", "002 -> 8, 001", "002 -> 9, 001", "002 -> 1, 003", 
-	"002 -> 2, 003", "002 -> 3, 003", "002 -> 4, 003", "002 -> 5, 003", "002 -> 6, 003", "002 -> 7, 003", "002 -> 8, 003", "002 -> 9, 003", "002 -> 0, 004", "002 -> 1, 004", "002 -> 2, 004", 
-	"002 -> 3, 004", "002 -> 4, 004", "002 -> 5, 004", "002 -> 6, 004", "002 -> 7, 004", "002 -> 8, 004", "002 -> 9, 004",
-
-	"003 -> 0, 001", "003 -> 1, 001", "003 -> 2, 001", "003 -> 3, 001", "003 -> 4, 001", "003 -> 5, 001", "003 -> 6, 001", "003 -> 7, 001", "003 -> 8, 001", "003 -> 9, 001", "003 -> 0, 003",
-	"003 -> 1, 003", "003 -> 2, 003", "003 -> 3, 003", "003 -> 4, 003", "003 -> 5, 003", "003 -> 6, 003", "003 -> 7, 003", "003 -> 8, 003", "003 -> 9, 003", "003 -> 0, 004", "003 -> 1, 004",
-	"003 -> 2, 004", "003 -> 3, 004", "003 -> 4, 004", "003 -> 5, 004", "003 -> 6, 004", "003 -> 7, 004", "003 -> 8, 004", "003 -> 9, 004",
-
-	"004 -> -, 000", "004 -> +, 000"
-};
-
-const unsigned char NOVA_LANG_CONTEXT[NUM_NOVA_LANG_RULES] = {0, 2, 0, 0, 1};
-
-struct dictionary_t *create_dictionary();
-char dictionary(struct parse_t *, int *, int *);
-unsigned char alpha_index(int);
-
-struct dictionary_t *create_dictionary() {
-	struct dictionary_t *ret_val = malloc(sizeof(struct dictionary_t));
-	if(ret_val != NULL) {
-		ret_val->dict = malloc(sizeof(char *) * NUM_NOVA_LANG_RULES * NUM_NOVA_LANG_ALPHA);
-		if(ret_val->dict != NULL) {
-
-			uint64_t count = 0;
-			for(; count < NUM_NOVA_LANG_RULES * NUM_NOVA_LANG_ALPHA; ++count) {
-				ret_val->dict[count] = malloc(sizeof(char));
-				if(ret_val->dict[count] != NULL) {
-					*ret_val->dict[count] = NOVA_LANG_EMPTY;
-				} else {
-					while(count > 0) {
-						free(ret_val->dict[--count]);
-					}
-					free(ret_val->dict);
-					free(ret_val);
-					ret_val = NULL;
-					break;
-				}
-			}
-
-			if(ret_val != NULL) {
-				ret_val->num_rules = NUM_NOVA_LANG_RULES;
-				ret_val->num_alpha = NUM_NOVA_LANG_ALPHA;
-
-				char rule_left_str[NOVA_RULE_LEN + 1], rule_right_str[NOVA_RULE_LEN + 1], alpha_char;
-				rule_left_str[NOVA_RULE_LEN] = '\0';
-				rule_right_str[NOVA_RULE_LEN] = '\0';
-				const char *strptr = NULL;
-				unsigned char rule_left, rule_right, alpha, char_count;
-				uint64_t dict_index = char_count = 0;
-				unsigned char *cursor, *temp;
-				cursor = temp = NULL;
-
-				for(count = 0; count < NUM_NOVA_LANG_PRODS; ++count) {
-					
-					strptr = NOVA_LANG_PRODS[count];
-					strncpy(rule_left_str, strptr, NOVA_RULE_LEN);
-					alpha_char = *(strptr += (NOVA_RULE_LEN + NOVA_ARROW_LEN));
-					strncpy(rule_right_str, strptr + NOVA_CHAR_LEN + NOVA_DELIMIT_LEN, NOVA_RULE_LEN);
-
-					rule_left = (unsigned char)atoi(rule_left_str);
-					rule_right = (unsigned char)atoi(rule_right_str);
-					
-					alpha = alpha_index(alpha_char);
-
-					dict_index = rule_left * ret_val->num_alpha + alpha;
-					temp = cursor = ret_val->dict[dict_index];
-					char_count = 0;
-					while(*cursor != NOVA_LANG_EMPTY) {
-						++char_count;
-						++cursor;
-					}
-					
-					ret_val->dict[dict_index] = realloc(ret_val->dict[dict_index], char_count + 1);
-					if(ret_val->dict[dict_index] != NULL) {
-						ret_val->dict[dict_index][char_count] = rule_right;
-						ret_val->dict[dict_index][char_count + 1] = NOVA_LANG_EMPTY;
+void interpret_publish(struct interpret_t *);
+void interpret_malformed(struct interpret_t *);
+void interpret_end(struct interpret_t *);
+void interpret_line_end(struct interpret_t *);
+void interpret_close(struct interpret_t *);
+
+//Most context records a single parsed character can append.
+#define NOVA_CONTEXT_PER_CHAR 2
+
+//Bytes classified at once when looking for the end of a number, and digits converted at once in a word.
+#define NOVA_DIGIT_BLOCK 16
+#define NOVA_DIGIT_WORD 8
+
+//Most completed statements the interpreter holds back before telling the executor about them at once. Whatever it holds is told at the end of every pass regardless.
+#define NOVA_PUBLISH_BATCH 64
+
+//The grammar table Nova is built with, the table parsers take up at the start of each statement, and the loaded tables it has replaced.
+struct lang_table_t lang_table_builtin = {NOVA_TABLE_RULES, NOVA_TABLE_CLASSES, NOVA_TABLE_CLASS, NOVA_TABLE_NEXT, NOVA_TABLE_CONTEXT, NOVA_TABLE_DIGIT_LOOP, NULL};
+_Atomic(struct lang_table_t *) lang_table_current = &lang_table_builtin;
+struct lang_table_t *lang_table_retired = NULL;
+pthread_mutex_t lang_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//Loads a grammar table from a file written by novagen. Returns NULL if the file cannot be read, or does not hold exactly one table whose rules and classes are all in range.
+struct lang_table_t *lang_table_load(const char *path) {
+	struct lang_table_t *ret_val = NULL;
+	FILE *file = path != NULL ? fopen(path, "rb") : NULL;
+	if(file != NULL) {
+		struct nova_table_header_t header;
+		if(fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, NOVA_TABLE_MAGIC, NOVA_TABLE_MAGIC_LEN) == 0) {
+			uint32_t rules = le32toh(header.num_rules);
+			uint32_t classes = le32toh(header.num_classes);
+			if(rules > 0 && rules <= NOVA_TABLE_MAX_RULES && classes > 0 && classes <= NOVA_TABLE_MAX_CLASSES) {
+
+				//The table is kept in the same allocation as its struct.
+				uint64_t size = NOVA_TABLE_SIZE(rules, classes) - sizeof(header);
+				ret_val = malloc(sizeof(struct lang_table_t) + size);
+				if(ret_val != NULL) {
+					unsigned char *data = (unsigned char *)(ret_val + 1);
+					ret_val->num_rules = rules;
+					ret_val->num_classes = classes;
+					ret_val->classes = data;
+					ret_val->next = data + 256;
+					ret_val->context = ret_val->next + (uint64_t)rules * classes * classes;
+					ret_val->digit_loop = ret_val->context + rules;
+					ret_val->retired = NULL;
+					if(fread(data, 1, size, file) != size || fgetc(file) != EOF || !lang_table_valid(ret_val)) {
+						free(ret_val);
+						ret_val = NULL;
 					}
 				}
 			}
 		}
+		fclose(file);
 	}
-
 	return ret_val;
 }
-unsigned char alpha_index(int alpha) {
-	unsigned char cur_index = NUM_NOVA_LANG_ALPHA / 2;
-	int cur = 0;
-	unsigned char min = 0;
-	unsigned char max = NUM_NOVA_LANG_ALPHA;
-	while(min != max) {
-		cur = (int)NOVA_LANG_ALPHA[cur_index];
-		if(alpha > cur) {
-			min = cur_index + 1;
-			cur_index += (max - cur_index) / 2;
-		} else if(alpha < cur) {
-			max = cur_index - 1;
-			cur_index -= (cur_index - min) / 2;
-		} else {
-			max = cur_index;
-			break;
+
+//Checks that a loaded table only names classes, rules and contexts that exist, so that no table can send the parser out of bounds.
+char lang_table_valid(struct lang_table_t *table) {
+	for(int count = 0; count < 256; ++count) {
+		if(table->classes[count] >= table->num_classes) return 0;
+	}
+	for(uint64_t count = 0; count < (uint64_t)table->num_rules * table->num_classes * table->num_classes; ++count) {
+		if(table->next[count] >= table->num_rules && table->next[count] != NOVA_LANG_EMPTY) return 0;
+	}
+	for(uint32_t count = 0; count < table->num_rules; ++count) {
+		if(table->context[count] > NOVA_LANG_CONTEXT_MAX || table->digit_loop[count] > 1) return 0;
+	}
+	return 1;
+}
+
+//Puts a table in place of the one parsers take up. Each parser moves to it when it starts its next statement. The table replaced is retired rather than freed, since parsers may still be on it.
+void lang_table_swap(struct lang_table_t *table) {
+	if(table != NULL) {
+		struct lang_table_t *old = atomic_exchange_explicit(&lang_table_current, table, memory_order_acq_rel);
+		if(old != &lang_table_builtin) {
+			pthread_mutex_lock(&lang_table_lock);
+			old->retired = lang_table_retired;
+			lang_table_retired = old;
+			pthread_mutex_unlock(&lang_table_lock);
 		}
 	}
+}
 
-	return max;
+//Frees every loaded table and puts the built in table back. No parser may be running.
+void lang_table_release() {
+	lang_table_swap(&lang_table_builtin);
+	pthread_mutex_lock(&lang_table_lock);
+	while(lang_table_retired != NULL) {
+		struct lang_table_t *table = lang_table_retired;
+		lang_table_retired = table->retired;
+		free(table);
+	}
+	pthread_mutex_unlock(&lang_table_lock);
 }
 
+char dictionary(struct parse_t *, int *, int *);
+
+//Moves the parser to the rule for the current character and its look ahead, with a load for each class and one for the rule. Returns zero if the statement is wrong.
 char dictionary(struct parse_t *parse, int *c, int *ahead) {
 	if(parse != NULL) {
-		if(parse->dict != NULL) {
-			unsigned char *search_list = NULL;
-			unsigned char check_result;
-			unsigned char alpha = alpha_index(*c);
-			if(alpha != NOVA_LANG_EMPTY) search_list = parse->dict->dict[parse->current_prod * parse->dict->num_alpha + alpha];
-			if(search_list != NULL) {
-				while(*search_list != NOVA_LANG_EMPTY) {
-					alpha = alpha_index(*ahead);
-					if(alpha != NOVA_LANG_EMPTY) check_result = parse->dict->dict[*search_list * parse->dict->num_alpha + alpha][0];
-					else check_result = NOVA_LANG_EMPTY;
-					
-					if(check_result != NOVA_LANG_EMPTY) {
-						parse->last_context = parse->current_context;
-						parse->current_context = NOVA_LANG_CONTEXT[*search_list];
-						parse->current_prod = *search_list;
-						return 1;
-					}
-					++search_list;
-				}
-			}
+		struct lang_table_t *table = parse->table;
+		unsigned char next = table->next[(parse->current_prod * table->num_classes + table->classes[(unsigned char)*c]) * table->num_classes + table->classes[(unsigned char)*ahead]];
+		if(next != NOVA_LANG_EMPTY) {
+			parse->last_context = parse->current_context;
+			parse->current_context = table->context[next];
+			parse->current_prod = next;
+			return 1;
 		}
 	}
 	return 0;
@@ -177,20 +143,19 @@ struct parse_t *parse_create() {
 	struct parse_t *ret_val = malloc(sizeof(struct parse_t));
 	//Initialize.
 	if(ret_val != NULL) {
-		ret_val->dict = create_dictionary();
-		if(ret_val->dict != NULL) {
-			
-			ret_val->in_buf = NULL;
-			ret_val->out_buf = NULL;
-			ret_val->context_queue = NULL;	
-			ret_val->current_context = 0;
-			ret_val->last_context = 0;
-			ret_val->current_prod = 0;
-			ret_val->cont_flag = 1;
-		} else {
-			free(ret_val);
-			ret_val = NULL;
-		}
+		ret_val->in_buf = NULL;
+		ret_val->out_buf = NULL;
+		ret_val->context_queue = NULL;	
+		ret_val->table = atomic_load_explicit(&lang_table_current, memory_order_acquire);
+		ret_val->current_context = 0;
+		ret_val->last_context = 0;
+		ret_val->current_prod = 0;
+		ret_val->current = 0;
+		ret_val->last = 0;
+		ret_val->look_ahead = 0;
+		ret_val->fused = 0;
+		ret_val->held = 0;
+		ret_val->cont_flag = 1;
 	}
 	return ret_val;
 }
@@ -262,57 +227,92 @@ void *do_parse(void *parse_ptr) {
 		if(in_buf != NULL && out_buf != NULL) {
 
 			//Variables on the stack to be used by this thread during parse runtime.
-			int current = 0;
-			int last = 0;
-			int look_ahead = 0;
 			uint64_t in_diff = 0;
 			uint64_t out_diff = 0;
 
 			//Loop until program termination begins.
 			while(parse->cont_flag) {
 
-				//Lock buffer. Do control logic.
-				buffer_read_lock(in_buf);	
-				buffer_write_lock(out_buf);	
+				//Wait for the interpreter to free up room in the context queue, so that a pass always makes progress.
+				while(!context_reserve(parse->context_queue, NOVA_CONTEXT_PER_CHAR)) sched_yield();
 
-				//Check if write is ahead of read. If so read until write.
-				if(out_buf->cursor_read > out_buf->cursor_write) {
-					if(in_buf->cursor_write > in_buf->cursor_read) parse_through(parse, in_buf->cursor_write - in_buf->cursor_read, out_buf->cursor_read - out_buf->cursor_write, &current, &last, &look_ahead, &in_diff, &out_diff);
-					else parse_through(parse, in_buf->end - in_buf->cursor_read, out_buf->cursor_read - out_buf->cursor_write, &current, &last, &look_ahead, &in_diff, &out_diff);
-				//Otherwise, the read is ahead of write. If so read until end.
-				} else {
-					if(in_buf->cursor_write > in_buf->cursor_read) parse_through(parse, in_buf->cursor_write - in_buf->cursor_read, out_buf->end - out_buf->cursor_write, &current, &last, &look_ahead, &in_diff, &out_diff);
-					else parse_through(parse, in_buf->end - in_buf->cursor_read, out_buf->end - out_buf->cursor_write, &current, &last, &look_ahead, &in_diff, &out_diff);
+				//Get the input span. Do control logic.
+				buffer_peek(in_buf, 1);
+
+				//Once the input has been closed and read to the end, end a statement still waiting on its look ahead and stop.
+				if(buffer_drained(in_buf)) {
+					buffer_consume(in_buf, 0);
+					parse_finish(parse);
+					break;
 				}
 
-				//Update the cursor.
-				in_buf->cursor_read += in_diff;
-				//Unlock buffer. Do control logic.
-				buffer_read_unlock(in_buf, in_diff);
-				
-				//Update the cursor.
-				out_buf->cursor_write += out_diff;
-				//Unlock buffer. Do control logic.
-				buffer_write_unlock(out_buf, out_diff);
+				//Get the output span. Do control logic.
+				buffer_reserve(out_buf, 1);
+
+				//Parse as far as both the readable input and the writable output allow.
+				parse_through(parse, buffer_read_span(in_buf), buffer_write_span(out_buf), &parse->current, &parse->last, &parse->look_ahead, &in_diff, &out_diff);
+
+				//Release the input and publish the output. Do control logic.
+				buffer_consume(in_buf, in_diff);
+				buffer_commit(out_buf, out_diff);
 
 				//Reset cursor counter.
 				in_diff = 0;
 				out_diff = 0;
 			}
+
+			//Tell the interpreter there is nothing more to come.
+			buffer_close(out_buf);
 		}
 	}
 	pthread_exit(NULL);
 }
 
+//Parses as much as can be parsed without waiting, for a parse node stepped by a shared worker rather than run by a thread of its own.
+//Once the input has been closed and read to the end, finishes the last statement and closes the output. Returns 1 if any progress was made.
+char parse_step(struct parse_t *parse) {
+	char ret_val = 0;
+	if(parse != NULL && parse->cont_flag && !parse->held && parse->in_buf != NULL && parse->out_buf != NULL && context_reserve(parse->context_queue, NOVA_CONTEXT_PER_CHAR)) {
+		uint64_t in_diff = 0;
+		uint64_t out_diff = 0;
+		if(buffer_try_peek(parse->in_buf) != NULL) {
+			if(buffer_try_reserve(parse->out_buf, 1) != NULL) {
+				parse_through(parse, buffer_read_span(parse->in_buf), buffer_write_span(parse->out_buf), &parse->current, &parse->last, &parse->look_ahead, &in_diff, &out_diff);
+				buffer_consume(parse->in_buf, in_diff);
+				buffer_commit(parse->out_buf, out_diff);
+				ret_val = in_diff > 0 || out_diff > 0;
+			}
+		} else if(buffer_drained(parse->in_buf)) {
+			parse_finish(parse);
+			buffer_close(parse->out_buf);
+			parse->cont_flag = 0;
+			ret_val = 1;
+		}
+	}
+	return ret_val;
+}
+
+//Ends a statement still waiting on its look ahead when the input ends. The caller must have checked for room in the context queue.
+void parse_finish(struct parse_t *parse) {
+	if(parse->last != 0) {
+		context_increment(parse->context_queue, 1);
+		parse_end(parse);
+		parse->last = 0;
+	}
+}
+
 //Does parsing for the input provided on buffer buf up to max_size using the provided parse struct and the provided character, rule, and production holders, and the rule, production, and character counters.
 void parse_through(struct parse_t *parse, uint64_t max_size_in, uint64_t max_size_out, int *current, int *last, int *look_ahead, uint64_t *in_diff, uint64_t *out_diff) {
 	
-	//Loop until max size is reached.
-	while(*in_diff < max_size_in && *out_diff < max_size_out) {
+	//Loop until max size is reached, or until the context queue has no room for what one more character may append.
+	while(*in_diff < max_size_in && *out_diff < max_size_out && context_reserve(parse->context_queue, NOVA_CONTEXT_PER_CHAR)) {
 	
 		//Get current character.
 		if(*last == 0) {
 			*current = (int)*((char *)parse->in_buf->cursor_read + (*in_diff)++);	
+
+			//A statement is ended by its look ahead, so a statement end read here is a blank line. Skip it without passing it on.
+			if(NOVA_STATEMENT_END(*current)) continue;
 			*((char *)(parse->out_buf->cursor_write + (*out_diff)++)) = *((char *)current);
 		} else {
 			*current = *last;
@@ -322,37 +322,153 @@ void parse_through(struct parse_t *parse, uint64_t max_size_in, uint64_t max_siz
 		if(*in_diff < max_size_in) {
 			*look_ahead = (int)*((char *)parse->in_buf->cursor_read + *in_diff);
 			context_increment(parse->context_queue, 1);
-			if(*look_ahead != '\0') {
+			if(!NOVA_STATEMENT_END(*look_ahead)) {
 				if(dictionary(parse, current, look_ahead)) {
-						if(parse->current_context != parse->last_context) context_append(parse->context_queue, parse->last_context);
-				//Syntax error handling will be done here.
-				} else printf("Error State\n");
+					if(parse->current_context != parse->last_context) context_append(parse->context_queue, parse->last_context);
+
+					//Inside a number the rule and context stay the same for every digit but the last, so those digits are passed on in one copy.
+					if(parse->table->digit_loop[parse->current_prod]) {
+						uint64_t run = parse_count_digits((char *)parse->in_buf->cursor_read + *in_diff, max_size_in - *in_diff);
+						if(run > 1) {
+							if(--run > max_size_out - *out_diff) run = max_size_out - *out_diff;
+							memcpy((char *)parse->out_buf->cursor_write + *out_diff, (char *)parse->in_buf->cursor_read + *in_diff, run);
+							context_increment(parse->context_queue, run);
+							*in_diff += run;
+							*out_diff += run;
+						}
+					}
+				//The record holding the character is marked, so the results of its statement are given as malformed. The diagnostic goes to standard error, as results are written to standard output by the output node alone.
+				} else {
+					context_fail(parse->context_queue);
+					fprintf(stderr, "Error State\n");
+				}
 			} else {
 				++(*in_diff);
-			
-				context_append(parse->context_queue, parse->current_context);
-				context_append(parse->context_queue, -1);
-				parse->current_prod = 0;
-				parse->current_context = 0;
-				parse->last_context = 0;
+				parse_end(parse);
+				if(parse->fused) break;
 			}
 		} else *last = *current;
 	}
 }
 
+//Evaluates simple statements straight from the input while the rest of the pipeline is idle, for a pipeline stepped by one worker. Returns 1 if any progress was made.
+//A simple statement is signed numbers joined by + and -, ended by ; and a line end, under the grammar Nova is built with. Its sum is written out as the next result without going through the context queue or the stacks.
+//The first statement that is anything else is left to the parser, which then stops at its end so the fused pass can take over again.
+char fuse_step(struct parse_t *parse, struct interpret_t *interpret, struct execute_t *execute) {
+	char ret_val = 0;
+	if(parse == NULL || interpret == NULL || execute == NULL || !parse->cont_flag) return ret_val;
+	parse->fused = parse->table == &lang_table_builtin;
+	parse->held = 0;
+	struct context_queue_t *queue = parse->context_queue;
+
+	//A line end record reads nothing, so it may be left after the interpreter's last pass. It is retired here, ending a statement left without its statement end. Nothing else can be left for the pipeline to finish.
+	while(context_complete(queue) && context_size(queue) == 0 && context_type(queue) == (uint64_t)-1) interpret_line_end(interpret);
+	interpret_publish(interpret);
+	uint64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+	if(!parse->fused || parse->last != 0 || parse->current_prod != 0 || context_complete(queue) || atomic_load_explicit(&queue->ring[head & queue->mask].size, memory_order_relaxed) != 0) return ret_val;
+	if(interpret->current_count != 0 || (interpret->code != NULL && interpret->code->size != 0) || interpret->op != 0 || interpret->pending != 0) return ret_val;
+	if(atomic_load_explicit(&execute->stack->ready, memory_order_acquire) != execute->count) return ret_val;
+
+	char *text = buffer_try_peek(parse->in_buf);
+	if(text != NULL) {
+		uint64_t size = buffer_read_span(parse->in_buf);
+		uint64_t diff = 0;
+		while(diff < size) {
+
+			//Blank lines come to nothing, as they do in the parser.
+			if(NOVA_STATEMENT_END(text[diff])) {
+				++diff;
+				continue;
+			}
+			int value = 0;
+			uint64_t length = fuse_statement(text + diff, size - diff, &value);
+			if(length == 0) break;
+			if(!execute_fused(execute, value)) {
+				parse->held = 1;
+				break;
+			}
+			diff += length;
+		}
+		buffer_consume(parse->in_buf, diff);
+		ret_val = diff > 0;
+	}
+	return ret_val;
+}
+
+//Evaluates one simple statement at the start of the given text, wrapping around as the executor does. Returns how many characters it takes up to and including its line end, or 0 if it is not simple or runs past the text.
+uint64_t fuse_statement(const char *text, uint64_t size, int *value) {
+	const char *c = text;
+	const char *end = text + size;
+	uint32_t sum = 0;
+	char sub = 0;
+	while(1) {
+		char neg = 0;
+		if(c < end && (*c == '-' || *c == '+')) neg = *c++ == '-';
+
+		//A number may not have a leading zero.
+		uint64_t digits = parse_count_digits(c, end - c);
+		uint32_t number = 0;
+		if(digits == 0 || (*c == '0' && digits > 1)) return 0;
+		console_digits(c, digits, &number);
+		c += digits;
+		if(c == end) return 0;
+		if(neg) number = -number;
+		sum = sub ? sum - number : sum + number;
+
+		if(*c == '+' || *c == '-') sub = *c++ == '-';
+		else if(*c == ';' && c + 1 < end && NOVA_STATEMENT_END(c[1])) {
+			*value = (int)sum;
+			return c + 2 - text;
+		} else return 0;
+	}
+}
+
+//Counts the digits at the start of the given text, up to size of them. Whole blocks are classified with vector compares where the machine has them.
+uint64_t parse_count_digits(const char *text, uint64_t size) {
+	uint64_t count = 0;
+#ifdef __SSE2__
+	const __m128i zero = _mm_set1_epi8('0');
+	const __m128i nine = _mm_set1_epi8(9);
+	while(count + NOVA_DIGIT_BLOCK <= size) {
+
+		//A byte is a digit when it is at most nine past zero, compared without sign so bytes below zero wrap around.
+		__m128i block = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)(text + count)), zero);
+		unsigned int digits = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(block, nine), block));
+		if(digits != 0xFFFF) return count + __builtin_ctz(~digits);
+		count += NOVA_DIGIT_BLOCK;
+	}
+#endif
+	while(count < size && (unsigned char)(text[count] - '0') <= 9) ++count;
+	return count;
+}
+
+//Ends the current statement. Completes the record of its last element, appends the statement end record, and starts the grammar over on the newest table.
+void parse_end(struct parse_t *parse) {
+	context_append(parse->context_queue, parse->current_context);
+	context_append(parse->context_queue, -1);
+	parse->table = atomic_load_explicit(&lang_table_current, memory_order_acquire);
+	parse->current_prod = 0;
+	parse->current_context = 0;
+	parse->last_context = 0;
+}
+
 //Creates interpret node.
 struct interpret_t *interpret_create() {
 
 	//Allocate.
 	struct interpret_t *ret_val = malloc(sizeof(struct interpret_t));
-	struct execute_stack_t *back_stack = execute_stack_create();
+	struct execute_code_t *code = execute_code_create(EXECUTE_CODE_SIZE);
 	//Initialize.
-	if(ret_val != NULL && back_stack != NULL) {
+	if(ret_val != NULL && code != NULL) {
 		ret_val->in_buf = NULL;
 		ret_val->context_queue = NULL;
 		ret_val->execute_stack = NULL;
-		ret_val->back_stack = back_stack;
-		ret_val->current_element = NULL;
+		ret_val->code = code;
+		ret_val->literal = 0;
+		ret_val->op = 0;
+		ret_val->operands = 0;
+		ret_val->malformed = 0;
+		ret_val->pending = 0;
 		ret_val->current_count = 0;
 		ret_val->current_size = 0;
 		ret_val->neg_flag = 0;
@@ -364,7 +480,7 @@ struct interpret_t *interpret_create() {
 			free(ret_val);
 			ret_val = 0;
 		}
-		if(back_stack != NULL) execute_stack_destroy(&back_stack);
+		if(code != NULL) execute_code_destroy(code);
 	}
 	return ret_val;
 }
@@ -374,11 +490,8 @@ void interpret_destroy(struct interpret_t **interpret) {
 	if(interpret != NULL) {
 		if(*interpret != NULL) {
 
-			//Frees current execution element.
-			if((*interpret)->current_element != NULL) execute_element_destroy(&(*interpret)->current_element);
-			
-			//Frees back stack.
-			if((*interpret)->back_stack != NULL) execute_stack_destroy(&((*interpret)->back_stack));	
+			//Frees the code of the statement left unfinished.
+			if((*interpret)->code != NULL) execute_code_destroy((*interpret)->code);
 
 			//Frees node.
 			free(*interpret);
@@ -443,69 +556,131 @@ void *do_interpret(void *interpret_ptr) {
 			//Loop until program termination begins.
 			while(interpret->cont_flag) {
 
-				//Lock buffer. Do control logic.
-				buffer_read_lock(buf);	
+				//Wait for something to read. Do control logic.
+				buffer_peek(buf, 1);
 
-				if(buf->cursor_write > buf->cursor_read) interpret_in(interpret, buf->cursor_write - buf->cursor_read, &current, &diff);
-				else interpret_in(interpret, buf->end - buf->cursor_read, &current, &diff);
+				//Stop once the parser is done and everything it wrote has been read.
+				if(buffer_drained(buf)) {
+					buffer_consume(buf, 0);
+					break;
+				}
 
-				buf->cursor_read += diff;
+				interpret_in(interpret, buffer_read_span(buf), &current, &diff);
+				interpret_publish(interpret);
 
-				buffer_read_unlock(buf, diff);
+				//Release what was read. Do control logic.
+				buffer_consume(buf, diff);
 
 				//Reset cursor counter.
 				diff = 0;
 			}
+
+			//Tell the executor that no more statements are coming.
+			interpret_close(interpret);
 		}
 	}
 	pthread_exit(NULL);
 }
 
+//Interprets as much as can be interpreted without waiting, for an interpret node stepped by a shared worker rather than run by a thread of its own.
+//Once the input has been closed and read to the end, ends the last statement and closes the execution stack. Returns 1 if any progress was made.
+char interpret_step(struct interpret_t *interpret) {
+	char ret_val = 0;
+	if(interpret != NULL && interpret->cont_flag && interpret->in_buf != NULL) {
+		if(buffer_try_peek(interpret->in_buf) != NULL) {
+			int current = 0;
+			uint64_t diff = 0;
+
+			//A pass may only retire a statement end record, which reads nothing but is still progress.
+			uint64_t tail = atomic_load_explicit(&interpret->context_queue->tail, memory_order_relaxed);
+			interpret_in(interpret, buffer_read_span(interpret->in_buf), &current, &diff);
+			interpret_publish(interpret);
+			buffer_consume(interpret->in_buf, diff);
+			ret_val = diff > 0 || atomic_load_explicit(&interpret->context_queue->tail, memory_order_relaxed) != tail;
+		} else if(buffer_drained(interpret->in_buf)) {
+			interpret_close(interpret);
+			interpret->cont_flag = 0;
+			ret_val = 1;
+		}
+	}
+	return ret_val;
+}
+
+//Tells the executor about every completed statement held back, with one count and at most one wake.
+void interpret_publish(struct interpret_t *interpret) {
+	if(interpret->pending > 0) {
+		execute_stack_publish(interpret->execute_stack, interpret->pending);
+		interpret->pending = 0;
+	}
+}
+
+//Ends the statement being read, ending its last result if it has one. Its code goes behind the ones waiting to be run in one piece.
+void interpret_end(struct interpret_t *interpret) {
+	if(interpret->operands) execute_code_emit(&interpret->code, EXECUTE_OP_END, 0);
+	struct execute_element_t element;
+	execute_element_set_code(&element, &interpret->code);
+	if(!execute_stack_enqueue_value(interpret->execute_stack, &element)) execute_element_clear(&element);
+	if(++interpret->pending >= NOVA_PUBLISH_BATCH) interpret_publish(interpret);
+	interpret->operands = 0;
+	interpret->op = 0;
+	interpret->malformed = 0;
+}
+
+//Retires a line end record. A line missing its statement end is ended with it, so a statement never runs past its line, as the chunks of a batch do not.
+void interpret_line_end(struct interpret_t *interpret) {
+	if(interpret->operands) interpret_end(interpret);
+	context_remove(interpret->context_queue);
+}
+
+//Ends a statement left open when the input ends, tells the executor about everything held back, and tells it no more statements are coming.
+void interpret_close(struct interpret_t *interpret) {
+	if(interpret->operands) interpret_end(interpret);
+	interpret_publish(interpret);
+	execute_stack_close(interpret->execute_stack);
+}
+
+//Marks the results of the statement being read from here on as those of a malformed statement, once per statement.
+void interpret_malformed(struct interpret_t *interpret) {
+	if(!interpret->malformed) {
+		execute_code_emit(&interpret->code, EXECUTE_OP_MALFORMED, 0);
+		interpret->malformed = 1;
+	}
+}
+
 void interpret_in(struct interpret_t *interpret, uint64_t max_size, int *current, uint64_t *diff) {
 
-	while(*diff < max_size) {
+	while(1) {
 
-		pthread_mutex_lock(&interpret->context_queue->lock);
-		interpret->current_size = context_size(interpret->context_queue);
+		//A record the parser is still on has no type yet, and a number is read knowing its final length, so only complete records are taken.
+		if(!context_complete(interpret->context_queue)) return;
+
+		//Type first, so that a record seen as complete also has its final size.
 		interpret->current_type = context_type(interpret->context_queue);
-		pthread_mutex_unlock(&interpret->context_queue->lock);
+		interpret->current_size = context_size(interpret->context_queue);
 
 		//printf("Type: %ld\n", interpret->current_type);
 
-		if(interpret->current_size > max_size) interpret->current_size = max_size;
-		else if(interpret->current_size == 0) {
-			if(interpret->current_type == -1) {
-				context_remove(interpret->context_queue);
-			}
-			return;
+		//A line end reads nothing, so one straight after the span is still taken, and a line's last result is not held back until the next line comes.
+		if(interpret->current_size == 0) {
+			if(interpret->current_type != (uint64_t)-1) return;
+			interpret_line_end(interpret);
+			continue;
 		}
+		if(*diff >= max_size) return;
 
-		if(interpret->current_element == NULL) {
+		//A number starts from nothing, and an operator is only known once its character is read.
+		if(interpret->current_count == 0) {
 			interpret->neg_flag = 0;
-			switch(interpret->current_type) {
-				case 0:
-					interpret->current_element = execute_element_create(sizeof(int), 0);
-					break;
-				case 1:
-					interpret->current_element = execute_element_create(0, 1);
-					while(execute_stack_peek(interpret->back_stack) != NULL) {
-						execute_stack_push(interpret->execute_stack, execute_stack_pop(interpret->back_stack));
-					}
-					break;
-				case 2:
-					interpret->current_element = execute_element_create(0, 2);
-					//Do full backup
-					while(execute_stack_peek(interpret->execute_stack) != NULL) {
-						execute_stack_push(interpret->back_stack, execute_stack_pop(interpret->execute_stack));
-					}
-					break;
-				default:
-					//error.	
-					break;
-			}
-		}	
+			interpret->literal = 0;
+		}
 
-		while(interpret->current_count < interpret->current_size) {
+		//A number whose whole record is in the span is converted in one go rather than a character at a time.
+		if(interpret->current_type == 0 && interpret->current_count == 0 && interpret->current_size <= max_size - *diff && console_literal(interpret, (char *)interpret->in_buf->cursor_read + *diff, interpret->current_size)) {
+			*diff += interpret->current_size;
+			interpret->current_count = interpret->current_size;
+		}
+
+		while(interpret->current_count < interpret->current_size && *diff < max_size) {
 			*current = *((char *)interpret->in_buf->cursor_read + (*diff)++);
 
 			switch(interpret->current_type) {	
@@ -519,9 +694,9 @@ void interpret_in(struct interpret_t *interpret, uint64_t max_size, int *current
 					
 					if(context_size(interpret->context_queue) == 1) {
 						if(*current == '+') {
-							interpret->current_element->value = nova_add;
+							interpret->literal = EXECUTE_OP_ADD;
 						} else if(*current == '-') {
-							interpret->current_element->value = nova_sub;
+							interpret->literal = EXECUTE_OP_SUB;
 						}
 					}
 					break;
@@ -529,26 +704,37 @@ void interpret_in(struct interpret_t *interpret, uint64_t max_size, int *current
 			++interpret->current_count;
 		}
 
+		//A span may end inside a record. The rest of it is read on the next pass.
+		if(interpret->current_count < interpret->current_size) return;
+
+		//A record the parser found a grammar error in marks its statement. A number first ends the result before it, so that result keeps its own status.
+		char failed = context_failed(interpret->context_queue);
 		if(context_remove(interpret->context_queue)) {
+			if(failed && interpret->current_type != 0) interpret_malformed(interpret);
 			switch(interpret->current_type) {
+
+				//A number following another with no operator between is given as a result of its own.
 				case 0:
-					execute_stack_push(interpret->execute_stack, interpret->current_element);
+					if(interpret->operands && interpret->op == 0) execute_code_emit(&interpret->code, EXECUTE_OP_END, 0);
+					if(failed) interpret_malformed(interpret);
+					execute_code_emit(&interpret->code, EXECUTE_OP_PUSH, interpret->literal);
+					if(interpret->operands && interpret->op != 0) execute_code_emit(&interpret->code, interpret->op, 0);
+					interpret->operands = 1;
+					interpret->op = 0;
 					break;
+
+				//An operator with nothing before it takes zero instead.
 				case 1:
-					execute_stack_push(interpret->back_stack, interpret->current_element);
-					break;	
+					if(!interpret->operands) execute_code_emit(&interpret->code, EXECUTE_OP_PUSH, 0);
+					interpret->operands = 1;
+					interpret->op = (unsigned char)interpret->literal;
+					break;
+
+				//The statement is complete.
 				case 2:
-					execute_stack_push(interpret->execute_stack, interpret->current_element);
-					while(execute_stack_peek(interpret->back_stack) != NULL) {
-						struct execute_element_t *element = execute_stack_pop(interpret->back_stack);
-						execute_stack_push(interpret->execute_stack, element);
-						
-					}
-					
-					pthread_cond_signal(&interpret->execute_stack->exe_wait);
+					interpret_end(interpret);
 					break;
 			}
-			interpret->current_element = NULL;		
 			interpret->current_count = 0;
 		}
 	}
@@ -569,21 +755,60 @@ void interpret_in(struct interpret_t *interpret, uint64_t max_size, int *current
 }*/
 
 
+//Adds one character of a number record to the number, for a record read a character at a time.
+//Every character moves the number up a place, since a digit stands at the place its position in the record gives it. A minus makes the digits after it count down.
 void console_to_int(struct interpret_t *interpret, int *current) {
 	if(interpret != NULL && current != NULL) {
-		if(interpret->current_element->type_id == 0 && interpret->current_element->value != NULL) {
-			if(context_read(interpret->context_queue) <= context_size(interpret->context_queue) && *current > 0b00101111 && *current < 0b00111010) {
+		uint32_t number = (uint32_t)interpret->literal * 10;
+		if(*current > 0b00101111 && *current < 0b00111010) {
+			if(interpret->neg_flag) number -= *current - 0b00110000;
+			else number += *current - 0b00110000;
+		} else if(*current == 0b00101101) interpret->neg_flag = 1;
+		interpret->literal = (int)number;
+	}
+}
 
-				uint64_t ten_pow = 1;
-				for(uint64_t i = 0; i < interpret->current_size - interpret->current_count - 1; ++i) {
-					ten_pow *= 10;
-				}
+//Converts the whole of a number record at once, for a record that is a sign or none followed by digits. Returns 0 without converting anything if the record is anything else, so that it is read a character at a time.
+char console_literal(struct interpret_t *interpret, const char *text, uint64_t size) {
+	uint64_t start = *text == '-' || *text == '+';
+	uint32_t number = 0;
+	if(start == size || console_digits(text + start, size - start, &number) < 0) return 0;
+	interpret->literal = (int)(*text == '-' ? -number : number);
+	return 1;
+}
 
-				if(interpret->neg_flag) *((int *)interpret->current_element->value) -= (*current - 0b00110000) * ten_pow;
-				else *((int *)interpret->current_element->value) += (*current - 0b00110000) * ten_pow;
-				
-				context_read_inc(interpret->context_queue, 1);
-			} else if(*current == 0b00101101) interpret->neg_flag = 1;
-		} 
+//Converts a run of digits to a number. Eight digits at a time are checked and converted in one word with three multiply-adds, and the rest one at a time.
+//The number wraps around past 32 bits, as arithmetic does. Returns 1 if it wrapped, 0 if it fit, and -1 if a character is not a digit.
+int console_digits(const char *text, uint64_t size, uint32_t *value) {
+	int ret_val = 0;
+	uint64_t number = 0;
+	uint64_t count = 0;
+	for(; count + NOVA_DIGIT_WORD <= size; count += NOVA_DIGIT_WORD) {
+		uint64_t word;
+		memcpy(&word, text + count, sizeof(word));
+		word = le64toh(word) - 0x3030303030303030;
+
+		//A byte is a digit if it is at most nine past zero. Below zero it wraps to the top half, and above nine adding 118 carries it there.
+		if(((word + 0x7676767676767676) | word) & 0x8080808080808080) return -1;
+
+		//Pair the digits into tens, the tens into hundreds, and the hundreds into the eight digit number, the first digit being the lowest byte.
+		word = word * 10 + (word >> 8);
+		word = ((word & 0x000000FF000000FF) * (100 + (1000000ULL << 32)) + ((word >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32))) >> 32;
+		number = number * 100000000 + word;
+		if(number > UINT32_MAX) {
+			ret_val = 1;
+			number &= UINT32_MAX;
+		}
+	}
+	for(; count < size; ++count) {
+		unsigned char digit = text[count] - '0';
+		if(digit > 9) return -1;
+		number = number * 10 + digit;
+		if(number > UINT32_MAX) {
+			ret_val = 1;
+			number &= UINT32_MAX;
+		}
 	}
+	*value = (uint32_t)number;
+	return ret_val;
 }
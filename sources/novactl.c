@@ -0,0 +1,317 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novactl.c
+Purpose: Reads the runtime configuration of Nova, and runs a controller that resizes buffers as the load changes.
+*/
+
+//Necessary imports.
+#include"novactl.h"
+#include<stdlib.h>
+#include<string.h>
+#include<strings.h>
+#include<ctype.h>
+#include<time.h>
+
+//Private functions.
+char control_parse_size(const char *, uint64_t *);
+char control_parse_count(const char *, int *);
+char control_parse_flag(const char *, char *);
+char control_parse_name(const char *, char *, uint64_t);
+char control_parse_path(const char *, char *, uint64_t);
+char control_parse_format(const char *, char *);
+char control_busy(struct buffer_stats_t *, struct buffer_stats_t *, uint64_t *);
+char control_idle(struct buffer_stats_t *, struct buffer_stats_t *);
+
+//Create a configuration with the defaults.
+struct control_t *control_create() {
+	struct control_t *ret_val = malloc(sizeof(struct control_t));
+	if(ret_val != NULL) {
+		ret_val->buffer_size = CONTROL_BUFFER_SIZE;
+		ret_val->buffer_min = CONTROL_BUFFER_MIN;
+		ret_val->buffer_max = CONTROL_BUFFER_MAX;
+		ret_val->interval = CONTROL_INTERVAL;
+		ret_val->flush_latency = CONTROL_FLUSH_LATENCY;
+		ret_val->output_format = OUTPUT_FORMAT_TEXT;
+		ret_val->workers = CONTROL_WORKERS;
+		ret_val->adaptive = 1;
+		ret_val->input_block = 1;
+		ret_val->shm[0] = '\0';
+		ret_val->shm_producer = 0;
+		ret_val->listen[0] = '\0';
+		ret_val->grammar[0] = '\0';
+		atomic_init(&ret_val->cont_flag, 1);
+		pthread_mutex_init(&ret_val->lock, NULL);
+		ret_val->num_buffers = 0;
+	}
+	return ret_val;
+}
+
+//Deallocate a configuration. The controller thread must have been stopped and joined.
+void control_destroy(struct control_t **control) {
+	if(control != NULL) {
+		if(*control != NULL) {
+			pthread_mutex_destroy(&(*control)->lock);
+			free(*control);
+		}
+	}
+}
+
+//Sets one configuration key, as named in a configuration file. Returns 1 if the key is known and the value valid.
+char control_set(struct control_t *control, const char *key, const char *value) {
+	char ret_val = 0;
+	if(control != NULL && key != NULL && value != NULL) {
+		if(strcmp(key, "NOVA_BUFFER_SIZE") == 0) ret_val = control_parse_size(value, &control->buffer_size) && control->buffer_size > 0;
+		else if(strcmp(key, "NOVA_BUFFER_MIN") == 0) ret_val = control_parse_size(value, &control->buffer_min) && control->buffer_min > 0;
+		else if(strcmp(key, "NOVA_BUFFER_MAX") == 0) ret_val = control_parse_size(value, &control->buffer_max) && control->buffer_max > 0;
+		else if(strcmp(key, "NOVA_INTERVAL") == 0) ret_val = control_parse_size(value, &control->interval) && control->interval > 0;
+		else if(strcmp(key, "NOVA_FLUSH_LATENCY") == 0) ret_val = control_parse_size(value, &control->flush_latency);
+		else if(strcmp(key, "NOVA_OUTPUT") == 0) ret_val = control_parse_format(value, &control->output_format);
+		else if(strcmp(key, "NOVA_ADAPTIVE") == 0) ret_val = control_parse_flag(value, &control->adaptive);
+		else if(strcmp(key, "NOVA_INPUT_BLOCK") == 0) ret_val = control_parse_flag(value, &control->input_block);
+		else if(strcmp(key, "NOVA_SHM") == 0) ret_val = control_parse_name(value, control->shm, CONTROL_SHM_NAME_SIZE);
+		else if(strcmp(key, "NOVA_SHM_PRODUCER") == 0) ret_val = control_parse_flag(value, &control->shm_producer);
+		else if(strcmp(key, "NOVA_LISTEN") == 0) ret_val = control_parse_path(value, control->listen, CONTROL_PATH_SIZE);
+		else if(strcmp(key, "NOVA_GRAMMAR") == 0) ret_val = control_parse_path(value, control->grammar, CONTROL_GRAMMAR_SIZE);
+		else if(strcmp(key, "NOVA_WORKERS") == 0) ret_val = control_parse_count(value, &control->workers);
+	}
+	return ret_val;
+}
+
+//Reads a configuration file of KEY=VALUE lines, in the style of an environment file. Blank lines and lines starting with # are skipped.
+//Keys that do not start with NOVA_ are left for other programs. Returns 1 if the whole file was read.
+char control_load_file(struct control_t *control, const char *path) {
+	char ret_val = 0;
+	FILE *file = path != NULL ? fopen(path, "r") : NULL;
+	if(control != NULL && file != NULL) {
+		char line[CONTROL_LINE_SIZE];
+		int line_number = 0;
+		ret_val = 1;
+		while(ret_val && fgets(line, CONTROL_LINE_SIZE, file) != NULL) {
+			++line_number;
+
+			//Trim the line, and an export in front of the key.
+			char *key = line;
+			char *end = line + strlen(line);
+			while(isspace((unsigned char)*key)) ++key;
+			while(end > key && isspace((unsigned char)end[-1])) --end;
+			*end = '\0';
+			if(strncmp(key, "export ", 7) == 0) key += 7;
+			if(*key == '\0' || *key == '#') continue;
+
+			//Split at the equals sign and drop quotes around the value.
+			char *value = strchr(key, '=');
+			if(value == NULL) ret_val = 0;
+			else {
+				*value++ = '\0';
+				if(end - value >= 2 && (*value == '"' || *value == '\'') && end[-1] == *value) {
+					end[-1] = '\0';
+					++value;
+				}
+				if(strncmp(key, "NOVA_", 5) == 0) ret_val = control_set(control, key, value);
+			}
+			if(!ret_val) fprintf(stderr, "%s:%d: invalid setting\n", path, line_number);
+		}
+	} else if(path != NULL) fprintf(stderr, "Could not open configuration file %s\n", path);
+	if(file != NULL) fclose(file);
+	return ret_val;
+}
+
+//Reads the configuration file named by the NOVA_CONFIG environment variable, if it is set. Returns 0 only if the file could not be read.
+char control_load_env(struct control_t *control) {
+	const char *path = getenv(CONTROL_ENV_FILE);
+	return path == NULL || *path == '\0' || control_load_file(control, path);
+}
+
+//Reads options of the form --buffer-size=65536 from the command line. Each is the configuration key without NOVA_, in lower case and with dashes.
+//A flag without a value is set, and --no- in front of it clears it. --config=FILE reads a configuration file at that point.
+//Returns the index of the first argument that is not an option, or -1 on an invalid option.
+int control_parse_args(struct control_t *control, int argc, char **argv) {
+	int ret_val = 1;
+	for(; ret_val < argc; ++ret_val) {
+		const char *arg = argv[ret_val];
+		if(strcmp(arg, "--") == 0) {
+			++ret_val;
+			break;
+		}
+		if(strncmp(arg, "--", 2) != 0 || arg[2] == '\0') break;
+
+		//Turn the option name into a configuration key.
+		char key[CONTROL_LINE_SIZE] = "NOVA_";
+		const char *name = arg + 2;
+		const char *value = strchr(name, '=');
+		if(value == NULL) {
+			value = strncmp(name, "no-", 3) == 0 ? "0" : "1";
+			if(*value == '0') name += 3;
+		} else ++value;
+		uint64_t length = 5;
+		for(; *name != '\0' && *name != '=' && length < CONTROL_LINE_SIZE - 1; ++name) key[length++] = *name == '-' ? '_' : toupper((unsigned char)*name);
+		key[length] = '\0';
+
+		//Apply it.
+		char valid = strcmp(key, CONTROL_ENV_FILE) == 0 ? control_load_file(control, value) : control_set(control, key, value);
+		if(!valid) {
+			fprintf(stderr, "Invalid option %s\n", arg);
+			ret_val = -1;
+			break;
+		}
+	}
+	return ret_val;
+}
+
+//Prints the command line options.
+void control_usage(FILE *file, const char *program) {
+	fprintf(file, "Usage: %s [options] [script]\n", program);
+	fprintf(file, "  --buffer-size=N      starting size of the pipeline buffers (%d)\n", CONTROL_BUFFER_SIZE);
+	fprintf(file, "  --buffer-min=N       smallest size the controller shrinks a buffer to (%d)\n", CONTROL_BUFFER_MIN);
+	fprintf(file, "  --buffer-max=N       largest size the controller grows a buffer to (%d)\n", CONTROL_BUFFER_MAX);
+	fprintf(file, "  --interval=MS        how often the controller looks at the pipeline (%d)\n", CONTROL_INTERVAL);
+	fprintf(file, "  --flush-latency=US   longest results are held back to be written together, 0 to write at once (%d)\n", CONTROL_FLUSH_LATENCY);
+	fprintf(file, "  --output=FORMAT      write results as text, or as binary frames of little-endian records (text)\n");
+	fprintf(file, "  --[no-]adaptive      whether the controller runs at all (on)\n");
+	fprintf(file, "  --[no-]input-block   read input in whole blocks rather than a character at a time (on)\n");
+	fprintf(file, "  --shm=NAME           serve producers through the shared memory rings /NAME.in and /NAME.out\n");
+	fprintf(file, "  --shm-producer       with --shm, feed standard input to a running server and print its results\n");
+	fprintf(file, "  --listen=PATH        serve sessions on a Unix domain socket, with --workers workers\n");
+	fprintf(file, "  --workers=N          number of workers serving sessions or running a script (%d)\n", CONTROL_WORKERS);
+	fprintf(file, "  --grammar=FILE       parse with a grammar table compiled by novagen, loaded again on SIGHUP\n");
+	fprintf(file, "  --config=FILE        read settings from a file of NOVA_KEY=VALUE lines\n");
+	fprintf(file, "Sizes take a k, m or g suffix. The file named by %s is read before the options.\n", CONTROL_ENV_FILE);
+	fprintf(file, "A script given more than one worker is split at line ends and run on --workers workers, with results in order.\n");
+}
+
+//Parses a number with an optional k, m or g suffix.
+char control_parse_size(const char *value, uint64_t *number) {
+	char *end = NULL;
+	uint64_t ret_val = strtoull(value, &end, 10);
+	if(end == value) return 0;
+	switch(tolower((unsigned char)*end)) {
+		case 'g': ret_val <<= 10;
+		//Fall through.
+		case 'm': ret_val <<= 10;
+		//Fall through.
+		case 'k': ret_val <<= 10;
+			++end;
+			break;
+	}
+	if(*end != '\0') return 0;
+	*number = ret_val;
+	return 1;
+}
+
+//Parses a number of workers.
+char control_parse_count(const char *value, int *count) {
+	uint64_t number = 0;
+	char ret_val = control_parse_size(value, &number) && number > 0 && number <= CONTROL_WORKERS_LIMIT;
+	if(ret_val) *count = number;
+	return ret_val;
+}
+
+//Parses a yes or no value.
+char control_parse_flag(const char *value, char *flag) {
+	char ret_val = 1;
+	if(strcmp(value, "1") == 0 || strcasecmp(value, "yes") == 0 || strcasecmp(value, "on") == 0 || strcasecmp(value, "true") == 0) *flag = 1;
+	else if(strcmp(value, "0") == 0 || strcasecmp(value, "no") == 0 || strcasecmp(value, "off") == 0 || strcasecmp(value, "false") == 0) *flag = 0;
+	else ret_val = 0;
+	return ret_val;
+}
+
+//Parses a name of fewer than size characters, made of letters, digits, dashes, dots and underscores. An empty name clears the setting.
+char control_parse_name(const char *value, char *name, uint64_t size) {
+	char ret_val = strlen(value) < size;
+	for(const char *c = value; ret_val && *c != '\0'; ++c) ret_val = isalnum((unsigned char)*c) || *c == '-' || *c == '.' || *c == '_';
+	if(ret_val) strcpy(name, value);
+	return ret_val;
+}
+
+//Parses the name of an output format.
+char control_parse_format(const char *value, char *format) {
+	char ret_val = 1;
+	if(strcasecmp(value, "text") == 0) *format = OUTPUT_FORMAT_TEXT;
+	else if(strcasecmp(value, "binary") == 0) *format = OUTPUT_FORMAT_BINARY;
+	else ret_val = 0;
+	return ret_val;
+}
+
+//Parses a path of fewer than size characters. An empty path clears the setting.
+char control_parse_path(const char *value, char *path, uint64_t size) {
+	char ret_val = strlen(value) < size;
+	if(ret_val) strcpy(path, value);
+	return ret_val;
+}
+
+//Adds a buffer for the controller to resize. Only lock-free buffers in memory of their own can be resized. Returns 1 on success.
+char control_add_buffer(struct control_t *control, struct buffer_t *buf) {
+	char ret_val = 0;
+	if(control != NULL && buffer_resizable(buf)) {
+		pthread_mutex_lock(&control->lock);
+		if(control->num_buffers < CONTROL_MAX_BUFFERS) {
+			struct control_buffer_t *entry = &control->buffers[control->num_buffers++];
+			entry->buf = buf;
+			entry->quiet = 0;
+			buffer_stats(buf, &entry->last);
+			ret_val = 1;
+		}
+		pthread_mutex_unlock(&control->lock);
+	}
+	return ret_val;
+}
+
+//Checks whether a buffer was under pressure since the last snapshot: the writer stalled on it and at least a quarter of the samples found it three quarters full or more.
+//Also gives the number of samples taken.
+char control_busy(struct buffer_stats_t *now, struct buffer_stats_t *last, uint64_t *samples) {
+	uint64_t high = 0;
+	*samples = 0;
+	for(int i = 0; i < BUFFER_STAT_BUCKETS; ++i) {
+		uint64_t count = now->occupancy[i] - last->occupancy[i];
+		*samples += count;
+		if(i >= BUFFER_STAT_BUCKETS * 3 / 4) high += count;
+	}
+	return now->writer_stalls > last->writer_stalls && *samples > 0 && high * 4 >= *samples;
+}
+
+//Checks whether a buffer had no pressure since the last snapshot: no writer stalls, and less than a fraction of its size went through it. An unused buffer is idle.
+//Occupancy is not used here, as the writer samples it against a cached read position that can stay stale for as long as there is room.
+char control_idle(struct buffer_stats_t *now, struct buffer_stats_t *last) {
+	return now->writer_stalls == last->writer_stalls && (now->bytes_written - last->bytes_written) * CONTROL_IDLE_FRACTION < now->size;
+}
+
+//Looks at the telemetry since the last step once. Buffers under pressure are doubled, and buffers that stay idle are halved, within the configured bounds.
+void control_step(struct control_t *control) {
+	if(control != NULL) {
+		pthread_mutex_lock(&control->lock);
+		for(int i = 0; i < control->num_buffers; ++i) {
+			struct control_buffer_t *entry = &control->buffers[i];
+			struct buffer_stats_t now;
+			uint64_t samples = 0;
+			buffer_stats(entry->buf, &now);
+			if(control_busy(&now, &entry->last, &samples)) {
+				entry->quiet = 0;
+				if(now.size < control->buffer_max) buffer_resize(entry->buf, now.size * 2 < control->buffer_max ? now.size * 2 : control->buffer_max);
+			} else if(control_idle(&now, &entry->last)) {
+				if(++entry->quiet >= CONTROL_SHRINK_INTERVALS) {
+					entry->quiet = 0;
+					if(now.size > control->buffer_min) buffer_resize(entry->buf, now.size / 2 > control->buffer_min ? now.size / 2 : control->buffer_min);
+				}
+			} else entry->quiet = 0;
+			entry->last = now;
+		}
+		pthread_mutex_unlock(&control->lock);
+	}
+}
+
+//Stops the controller thread. It finishes within one interval.
+void control_stop(struct control_t *control) {
+	if(control != NULL) atomic_store(&control->cont_flag, 0);
+}
+
+//Runs the controller until stopped.
+void *do_control(void *control_ptr) {
+	struct control_t *control = (struct control_t *)control_ptr;
+	struct timespec interval = {control->interval / 1000, control->interval % 1000 * 1000000};
+	while(atomic_load(&control->cont_flag)) {
+		nanosleep(&interval, NULL);
+		if(control->adaptive) control_step(control);
+	}
+	return NULL;
+}
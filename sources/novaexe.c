@@ -8,29 +8,46 @@ Purpose: To define nova execution line functions that do Nova's work at the C-le
 //Necessary imports.
 #include"novaexe.h"
 #include<stdlib.h>
+#include<string.h>
 
-typedef int (*binary_op)(int, int);
+//Elements, and code at the size it starts at, are taken from slabs, as they are made by one stage and freed by the next.
+struct slab_t execute_element_slab = SLAB_INITIALIZER(sizeof(struct execute_element_t));
+struct slab_t execute_code_slab = SLAB_INITIALIZER(sizeof(struct execute_code_t) + EXECUTE_CODE_SIZE);
+
+//Private functions.
+char execute_ready(void *);
+void execute_statement(struct execute_t *);
+void execute_emit(struct execute_t *, int, int);
+void execute_flush(struct execute_t *);
+char execute_spill(struct execute_t *, const char *, uint64_t);
+char execute_drain(struct execute_t *);
+uint64_t execute_op_length(unsigned char);
+void execute_stack_lock(struct execute_stack_t *);
+void execute_stack_unlock(struct execute_stack_t *);
+char execute_stack_grow(struct execute_stack_t *);
+uint64_t execute_result_space(struct execute_t *, uint64_t);
 
 //Creates execution node.
 struct execute_t *execute_create() {
 
 	//Allocate.
 	struct execute_t *ret_val = malloc(sizeof(struct execute_t));
-	struct execute_stack_t *back_stack = execute_stack_create();
 	//Initialize.
-	if(ret_val != NULL && back_stack != NULL) {
+	if(ret_val != NULL) {
 		
 		ret_val->stack = NULL;
-		ret_val->back_stack = back_stack;
+		ret_val->out_buf = NULL;
+		ret_val->num_results = 0;
+		ret_val->format = OUTPUT_FORMAT_TEXT;
+		ret_val->first = 0;
+		ret_val->fused = 0;
+		ret_val->count = 0;
+		ret_val->spill = NULL;
+		ret_val->spill_read = 0;
+		ret_val->spill_size = 0;
+		ret_val->spill_capacity = 0;
+		ret_val->stepped = 0;
 		ret_val->cont_flag = 1;
-
-	//Ensure that node creation is atomic.
-	} else {
-		if(ret_val != NULL) {
-			free(ret_val);
-			ret_val = NULL;
-		}
-		if(back_stack != NULL) execute_stack_destroy(&back_stack);
 	}
 	return ret_val;
 }
@@ -40,9 +57,9 @@ void execute_destroy(struct execute_t **execute) {
 	if(execute != NULL) {
 		if(*execute != NULL) {
 
-			//Free back stack.
-			if((*execute)->back_stack != NULL) execute_stack_destroy(&((*execute)->back_stack));
-			
+			//Free results still set aside.
+			if((*execute)->spill != NULL) free((*execute)->spill);
+
 			//Free node.
 			free(*execute);
 		}
@@ -63,113 +80,523 @@ struct execute_stack_t *execute_set_stack(struct execute_t *execute, struct exec
 	return ret_val;
 }
 
+//Takes a buffer and an execution node, sets the output buffer field of the node to the buffer, and returns whatever the old value of the field was.
+//Results are written to the output buffer if there is one, and printed otherwise.
+struct buffer_t *execute_set_out(struct execute_t *execute, struct buffer_t *buf) {
+	struct buffer_t *ret_val = NULL;
+	if(execute != NULL) {
+
+		//Get return value.
+		ret_val = execute->out_buf;
+
+		//Set new value.
+		execute->out_buf = buf;
+	}
+	return ret_val;
+}
+
+//Takes a format and an execution node, sets the format the node writes results in, and returns whatever the old format was.
+char execute_set_format(struct execute_t *execute, char format) {
+	char ret_val = OUTPUT_FORMAT_TEXT;
+	if(execute != NULL) {
+
+		//Get return value.
+		ret_val = execute->format;
+
+		//Set new value.
+		execute->format = format;
+	}
+	return ret_val;
+}
+
+//Takes a number of statements and an execution node, sets how many statements came before the first one the node runs, and returns whatever the old number was.
+//Results are numbered from there, for a node that runs one part of a larger input.
+uint64_t execute_set_first(struct execute_t *execute, uint64_t first) {
+	uint64_t ret_val = 0;
+	if(execute != NULL) {
+
+		//Get return value.
+		ret_val = execute->first;
+
+		//Set new value.
+		execute->first = first;
+	}
+	return ret_val;
+}
+
 void *do_execute(void *execute_ptr) {
 	if(execute_ptr != NULL) {
 		struct execute_t *execute = (struct execute_t *)execute_ptr;
 		struct execute_stack_t *stack = execute->stack;
-		struct execute_stack_t *back = execute->back_stack;
-		struct execute_element_t *current_element = NULL;
 		while(execute->cont_flag == 1) {
 		
-			pthread_mutex_lock(&stack->lock);
-			pthread_cond_wait(&stack->exe_wait, &stack->lock);
-			pthread_mutex_unlock(&stack->lock);
-
-			do {
-				current_element = execute_stack_pop(stack);
-				nova_run(stack, back, current_element);
+			//Wait until the interpreter has completed a statement that has not been run yet. Results gathered so far go out first.
+			if(!execute_ready(execute)) {
+				execute_flush(execute);
+				wait_for(&stack->wait, execute_ready, execute);
+			}
 
-			} while(current_element->type_id != 2);
-			execute_element_destroy(&current_element);	
+			//Stop once the interpreter has closed the stack and every statement on it has run. Otherwise run every statement it has completed so far in one go.
+			uint64_t ready = atomic_load_explicit(&stack->ready, memory_order_acquire);
+			if(ready == execute->count) break;
+			while(execute->count < ready) execute_statement(execute);
 		}
+
+		//Tell the output there are no more results.
+		execute_flush(execute);
+		if(execute->out_buf != NULL) buffer_close(execute->out_buf);
 	}
 	pthread_exit(NULL);
 }
 
-void nova_run(struct execute_stack_t *stack, struct execute_stack_t *back, struct execute_element_t *element) {
-	if(stack != NULL && back != NULL && element != NULL) {
-		int op_count = 0;
-		struct execute_element_t *back_top = NULL;
-		switch(element->type_id) {
-			case 0:
-				back_top = execute_stack_peek(back);
-				if(back_top != NULL) {
-					execute_stack_push(back, element);
-					if(back_top->type_id == 0) {
-						while(execute_stack_peek(back)->type_id == 0) {	
-							execute_stack_push(stack, execute_stack_pop(back));
-							++op_count;
-						}
-					}
-					switch(execute_stack_peek(back)->type_id) {
-						case 0:
-							break;
-						case 1:
-							if(op_count == 2) {
-								struct execute_element_t *op_one = execute_stack_pop(stack);
-								struct execute_element_t *op_two = execute_stack_pop(stack);
-								struct execute_element_t *op = execute_stack_pop(back);
-								binary_op op_func = op->value;
-								*(int *)op_two->value = op_func(*(int *)op_one->value, *(int *)op_two->value);
-								execute_stack_push(stack, op_two);
-								execute_element_destroy(&op_one);
-								execute_element_destroy(&op);
-							} else {
-								while(op_count > 0) {
-									execute_stack_push(back, execute_stack_pop(stack));
-									--op_count;
-								}
-							}
-							break;		
-						case 2:
-							break;
-					}
-				} else printf("%d\n", *(int *)element->value);
-				break;
-			case 1:
-				execute_stack_push(back, element);
-			case 2:
-				break;
-		}
-	}
-}
-
-struct execute_element_t *execute_element_create(size_t size, char type_id) {
-	struct execute_element_t *ret_val = malloc(sizeof(struct execute_element_t));
+//Runs every completed statement that can be run without waiting, for an execution node stepped by a shared worker rather than run by a thread of its own.
+//With an output buffer, stops while there is no room for the results gathered so far and another one. A statement with more results than there is room for sets the rest aside, and they go out before any more statements are run.
+//Returns 1 if any progress was made, including seeing that the stack has been closed and run to the end.
+char execute_step(struct execute_t *execute) {
+	char ret_val = 0;
+	if(execute != NULL && execute->cont_flag == 1 && execute->stack != NULL) {
+		execute->stepped = 1;
+		ret_val = execute_drain(execute);
+		uint64_t ready = atomic_load_explicit(&execute->stack->ready, memory_order_acquire);
+		while(ready > execute->count && execute->spill_size == 0) {
+			if(execute->out_buf != NULL && buffer_try_reserve(execute->out_buf, execute_result_space(execute, execute->num_results + 1)) == NULL) break;
+			execute_statement(execute);
+			ret_val = 1;
+		}
+		execute_flush(execute);
+		if(atomic_load_explicit(&execute->stack->closed, memory_order_acquire) && atomic_load_explicit(&execute->stack->ready, memory_order_acquire) == execute->count && execute->spill_size == 0) {
+			if(execute->out_buf != NULL) buffer_close(execute->out_buf);
+			execute->cont_flag = 0;
+			ret_val = 1;
+		}
+	}
+	return ret_val;
+}
+
+//Adds the result of a statement evaluated straight from the input rather than run from the stack, numbered after the statements before it.
+//Returns 0 without adding it if the output buffer has no room for it, as execute_step would, or if results set aside have yet to go out.
+char execute_fused(struct execute_t *execute, int value) {
+	if(execute->spill_size > 0) return 0;
+	if(execute->out_buf != NULL && buffer_try_reserve(execute->out_buf, execute_result_space(execute, execute->num_results + 1)) == NULL) return 0;
+	++execute->fused;
+	execute_emit(execute, value, OUTPUT_STATUS_OK);
+	return 1;
+}
+
+//Runs the next completed statement on the stack.
+void execute_statement(struct execute_t *execute) {
+	struct execute_element_t current_element;
+	++execute->count;
+	if(execute_stack_pop_value(execute->stack, &current_element)) {
+		if(current_element.type_id == EXECUTE_TYPE_INLINE) execute_code_run(execute, current_element.ops, current_element.size);
+		else if(current_element.value != NULL) execute_code_run(execute, ((struct execute_code_t *)current_element.value)->ops, ((struct execute_code_t *)current_element.value)->size);
+		execute_element_clear(&current_element);
+	}
+}
+
+//Creates empty code with room for the given number of bytes of instructions. Code at the starting size comes from its slab.
+struct execute_code_t *execute_code_create(uint64_t capacity) {
+	struct execute_code_t *ret_val = capacity == EXECUTE_CODE_SIZE ? slab_alloc(&execute_code_slab) : malloc(sizeof(struct execute_code_t) + capacity);
 	if(ret_val != NULL) {
-		ret_val->next = NULL;
-		if(size > 0) ret_val->value = calloc(1, size);
-		else ret_val->value = NULL;
-		ret_val->type_id = type_id;
+		ret_val->size = 0;
+		ret_val->capacity = capacity;
+		ret_val->last = 0;
+	}
+	return ret_val;
+}
+
+//Adds an instruction to the end of some code, with its number if it has one. The code is made first if there is none, and moved to a larger block when it is full.
+//A small number is pushed as a tagged byte, and an operator straight after a push is folded into it as an operator with a literal.
+//Returns 0 without adding anything if there is no memory for it.
+char execute_code_emit(struct execute_code_t **code, unsigned char op, int operand) {
+	if(*code == NULL) *code = execute_code_create(EXECUTE_CODE_SIZE);
+	if(*code == NULL) return 0;
+	uint64_t start = (*code)->size;
+	unsigned char *last = start > 0 ? (*code)->ops + (*code)->last : NULL;
+	if((op == EXECUTE_OP_ADD || op == EXECUTE_OP_SUB) && last != NULL && (*last == EXECUTE_OP_PUSH || *last & EXECUTE_OP_SMALL)) {
+		if(*last == EXECUTE_OP_PUSH) {
+			memcpy(&operand, last + 1, sizeof(int));
+			op = op == EXECUTE_OP_ADD ? EXECUTE_OP_ADD_LITERAL : EXECUTE_OP_SUB_LITERAL;
+		} else {
+			operand = *last & EXECUTE_SMALL_MAX;
+			op = op == EXECUTE_OP_ADD ? EXECUTE_OP_ADD_SMALL : EXECUTE_OP_SUB_SMALL;
+		}
+		start = (*code)->last;
+	} else if(op == EXECUTE_OP_PUSH && operand >= 0 && operand <= EXECUTE_SMALL_MAX) op = EXECUTE_OP_SMALL | (unsigned char)operand;
+	uint64_t length = execute_op_length(op);
+	if(start + length > (*code)->capacity) {
+		struct execute_code_t *temp = NULL;
+		if((*code)->capacity == EXECUTE_CODE_SIZE) {
+			if((temp = malloc(sizeof(struct execute_code_t) + (*code)->capacity * 2)) == NULL) return 0;
+			memcpy(temp, *code, sizeof(struct execute_code_t) + (*code)->size);
+			slab_free(&execute_code_slab, *code);
+		} else if((temp = realloc(*code, sizeof(struct execute_code_t) + (*code)->capacity * 2)) == NULL) return 0;
+		temp->capacity *= 2;
+		*code = temp;
+	}
+	unsigned char *cursor = (*code)->ops + start;
+	*cursor = op;
+	if(length == 1 + sizeof(int)) memcpy(cursor + 1, &operand, sizeof(int));
+	else if(length == 2) cursor[1] = (unsigned char)operand;
+	(*code)->last = start;
+	(*code)->size = start + length;
+	return 1;
+}
+
+//Destroys code, giving it back to the slab if it is still at the starting size.
+void execute_code_destroy(struct execute_code_t *code) {
+	if(code != NULL) {
+		if(code->capacity == EXECUTE_CODE_SIZE) slab_free(&execute_code_slab, code);
+		else free(code);
+	}
+}
+
+//Prints the counters of the slabs elements and code are taken from.
+void execute_report_slabs(FILE *file) {
+	slab_report(file, "execute elements", &execute_element_slab);
+	slab_report(file, "execute code", &execute_code_slab);
+}
+
+//Frees the slabs elements and code are taken from, with everything in them. Nothing may be using them.
+void execute_release_slabs() {
+	slab_release(&execute_element_slab);
+	slab_release(&execute_code_slab);
+}
+
+//Returns how many bytes an instruction takes with its number.
+uint64_t execute_op_length(unsigned char op) {
+	if(op == EXECUTE_OP_PUSH || op == EXECUTE_OP_ADD_LITERAL || op == EXECUTE_OP_SUB_LITERAL) return 1 + sizeof(int);
+	if(op == EXECUTE_OP_ADD_SMALL || op == EXECUTE_OP_SUB_SMALL) return 2;
+	return 1;
+}
+
+//Runs the code of a statement from start to end, adding a result at each end instruction, with the status the statement has reached.
+//The number on top is kept in a local and the ones under it in a small array of the running thread, so that pure arithmetic takes no locks and mostly stays in registers.
+//Arithmetic wraps around past 32 bits as nova_add and nova_sub do.
+void execute_code_run(struct execute_t *execute, const unsigned char *code, uint64_t size) {
+	if(code == NULL) return;
+
+	//A push moves the top down even when there is nothing on top yet, which takes one more place.
+	int operands[EXECUTE_OPERANDS + 1];
+	int *under = operands;
+	int top = 0;
+	int literal = 0;
+	int status = OUTPUT_STATUS_OK;
+	unsigned char op = 0;
+	const unsigned char *cursor = code;
+	const unsigned char *end = code + size;
+#ifdef EXECUTE_THREADED
+	static const void *dispatch[256] = {
+		[0 ... 0xFF] = &&op_stop,
+		[EXECUTE_OP_PUSH] = &&op_push,
+		[EXECUTE_OP_ADD] = &&op_add,
+		[EXECUTE_OP_SUB] = &&op_sub,
+		[EXECUTE_OP_END] = &&op_end,
+		[EXECUTE_OP_ADD_LITERAL] = &&op_add_literal,
+		[EXECUTE_OP_SUB_LITERAL] = &&op_sub_literal,
+		[EXECUTE_OP_ADD_SMALL] = &&op_add_small,
+		[EXECUTE_OP_SUB_SMALL] = &&op_sub_small,
+		[EXECUTE_OP_MALFORMED] = &&op_malformed,
+		[EXECUTE_OP_SMALL ... 0xFF] = &&op_small
+	};
+#define EXECUTE_CASE(label, value) label:
+#define EXECUTE_NEXT if(cursor == end) return; op = *cursor++; goto *dispatch[op]
+	EXECUTE_NEXT;
+#else
+#define EXECUTE_CASE(label, value) case value:
+#define EXECUTE_NEXT continue
+	while(cursor < end) {
+		op = *cursor++;
+		switch(op & EXECUTE_OP_SMALL ? EXECUTE_OP_SMALL : op) {
+#endif
+	EXECUTE_CASE(op_push, EXECUTE_OP_PUSH)
+		*under++ = top;
+		memcpy(&top, cursor, sizeof(int));
+		cursor += sizeof(int);
+		EXECUTE_NEXT;
+	EXECUTE_CASE(op_small, EXECUTE_OP_SMALL)
+		*under++ = top;
+		top = op & EXECUTE_SMALL_MAX;
+		EXECUTE_NEXT;
+	EXECUTE_CASE(op_add, EXECUTE_OP_ADD)
+		top = (int)((uint32_t)*--under + (uint32_t)top);
+		EXECUTE_NEXT;
+	EXECUTE_CASE(op_sub, EXECUTE_OP_SUB)
+		top = (int)((uint32_t)*--under - (uint32_t)top);
+		EXECUTE_NEXT;
+	EXECUTE_CASE(op_add_literal, EXECUTE_OP_ADD_LITERAL)
+		memcpy(&literal, cursor, sizeof(int));
+		cursor += sizeof(int);
+		top = (int)((uint32_t)top + (uint32_t)literal);
+		EXECUTE_NEXT;
+	EXECUTE_CASE(op_sub_literal, EXECUTE_OP_SUB_LITERAL)
+		memcpy(&literal, cursor, sizeof(int));
+		cursor += sizeof(int);
+		top = (int)((uint32_t)top - (uint32_t)literal);
+		EXECUTE_NEXT;
+	EXECUTE_CASE(op_add_small, EXECUTE_OP_ADD_SMALL)
+		top = (int)((uint32_t)top + *cursor++);
+		EXECUTE_NEXT;
+	EXECUTE_CASE(op_sub_small, EXECUTE_OP_SUB_SMALL)
+		top = (int)((uint32_t)top - *cursor++);
+		EXECUTE_NEXT;
+	EXECUTE_CASE(op_end, EXECUTE_OP_END)
+		execute_emit(execute, top, status);
+		top = *--under;
+		EXECUTE_NEXT;
+	EXECUTE_CASE(op_malformed, EXECUTE_OP_MALFORMED)
+		status = OUTPUT_STATUS_MALFORMED;
+		EXECUTE_NEXT;
+#ifdef EXECUTE_THREADED
+	op_stop:
+		return;
+#else
+		default:
+			return;
+		}
+	}
+#endif
+#undef EXECUTE_CASE
+#undef EXECUTE_NEXT
+}
+
+//Adds a result to the batch, with the number of the statement running and its status, and sends the batch out once it is full.
+void execute_emit(struct execute_t *execute, int value, int status) {
+	execute->sequences[execute->num_results] = execute->first + execute->fused + execute->count;
+	execute->statuses[execute->num_results] = status;
+	execute->results[execute->num_results++] = value;
+	if(execute->num_results == EXECUTE_BATCH_SIZE) execute_flush(execute);
+}
+
+//Formats the gathered results as one block, in text or as one binary frame, straight into the output buffer when it has room for all of them in one span, and prints them if there is no output buffer.
+//A stepped node sets the block aside instead of waiting when there is no room for it, or when results set aside before it have yet to go out.
+void execute_flush(struct execute_t *execute) {
+	if(execute->num_results > 0) {
+		uint64_t need = execute_result_space(execute, execute->num_results);
+		char block[EXECUTE_BLOCK_SIZE];
+		char *cursor = block;
+		char direct = 0;
+		char spill = execute->out_buf != NULL && execute->stepped && (execute->spill_size > 0 || buffer_try_reserve(execute->out_buf, need) == NULL);
+		if(execute->out_buf != NULL && !spill) {
+			cursor = buffer_reserve(execute->out_buf, need);
+			direct = buffer_write_span(execute->out_buf) >= need;
+
+			//A plain buffer may stop short at its end, so the block is formatted aside and copied in.
+			if(!direct) {
+				buffer_commit(execute->out_buf, 0);
+				cursor = block;
+			}
+		}
+		uint64_t size = execute->format == OUTPUT_FORMAT_BINARY ? output_format_frame(cursor, execute->results, execute->sequences, execute->statuses, execute->num_results) : output_format_ints(cursor, execute->results, execute->num_results);
+		if(direct) buffer_commit(execute->out_buf, size);
+		else if(execute->out_buf == NULL) fwrite(block, 1, size, stdout);
+		else if(!spill || !execute_spill(execute, block, size)) buffer_put(execute->out_buf, block, size);
+		execute->num_results = 0;
+	}
+}
+
+//Sets a formatted block aside behind any already set aside, making room for it as needed. Returns 0 if there is no memory for it.
+char execute_spill(struct execute_t *execute, const char *block, uint64_t size) {
+	if(execute->spill_size + size > execute->spill_capacity) {
+		uint64_t capacity = execute->spill_capacity > 0 ? execute->spill_capacity : EXECUTE_BLOCK_SIZE;
+		while(capacity < execute->spill_size + size) capacity *= 2;
+		char *temp = realloc(execute->spill, capacity);
+		if(temp == NULL) return 0;
+		execute->spill = temp;
+		execute->spill_capacity = capacity;
+	}
+	memcpy(execute->spill + execute->spill_size, block, size);
+	execute->spill_size += size;
+	return 1;
+}
+
+//Moves as much of what was set aside into the output buffer as there is room for. Returns 1 if any of it was moved.
+char execute_drain(struct execute_t *execute) {
+	char ret_val = 0;
+	while(execute->spill_read < execute->spill_size && buffer_try_reserve(execute->out_buf, 1) != NULL) {
+		uint64_t span = buffer_write_span(execute->out_buf);
+		if(span > execute->spill_size - execute->spill_read) span = execute->spill_size - execute->spill_read;
+		memcpy(execute->out_buf->cursor_write, execute->spill + execute->spill_read, span);
+		buffer_commit(execute->out_buf, span);
+		execute->spill_read += span;
+		ret_val = 1;
+	}
+	if(execute->spill_read == execute->spill_size) {
+		execute->spill_read = 0;
+		execute->spill_size = 0;
 	}
 	return ret_val;
 }
+
+//Returns the most bytes the given number of results can take in the format of the node.
+uint64_t execute_result_space(struct execute_t *execute, uint64_t count) {
+	return execute->format == OUTPUT_FORMAT_BINARY ? OUTPUT_FRAME_SIZE(count) : count * EXECUTE_RESULT_SIZE;
+}
+
+//Check used by the executor while waiting. Returns 1 if there is a completed statement that has not been run yet, or if the stack has been closed.
+char execute_ready(void *execute_ptr) {
+	struct execute_t *execute = (struct execute_t *)execute_ptr;
+	return atomic_load_explicit(&execute->stack->ready, memory_order_acquire) > execute->count || atomic_load_explicit(&execute->stack->closed, memory_order_acquire);
+}
+
+//Fills an element with the code of a statement. Code that fits is copied into the element and emptied to be compiled into again, and longer code is handed over to the element with new code made in its place.
+void execute_element_set_code(struct execute_element_t *element, struct execute_code_t **code) {
+	element->next = NULL;
+	element->size = 0;
+	element->type_id = EXECUTE_TYPE_INLINE;
+	if(*code == NULL) return;
+	if((*code)->size <= EXECUTE_INLINE_SIZE) {
+		memcpy(element->ops, (*code)->ops, (*code)->size);
+		element->size = (uint32_t)(*code)->size;
+		(*code)->size = 0;
+	} else {
+		element->value = *code;
+		element->type_id = EXECUTE_TYPE_CODE;
+		*code = execute_code_create(EXECUTE_CODE_SIZE);
+	}
+}
+
+//Frees the value an element points to, unless the element holds it inline or it is an operator. The element itself is left alone.
+void execute_element_clear(struct execute_element_t *element) {
+	if(element->type_id == EXECUTE_TYPE_CODE) execute_code_destroy(element->value);
+	else if(element->value != NULL && element->type_id != 1 && element->type_id != EXECUTE_TYPE_INLINE) free(element->value);
+	element->value = NULL;
+}
+
 void execute_element_destroy(struct execute_element_t **element) {
 	if(element != NULL) {
 		if(*element != NULL) {
-			if((*element)->value != NULL && (*element)->type_id != 1) free((*element)->value);
-			free(*element);
+			execute_element_clear(*element);
+			slab_free(&execute_element_slab, *element);
 			*element = NULL;
 		}
 	}
 }
 
+//Locks a stack unless it is a ring used by one thread at a time.
+void execute_stack_lock(struct execute_stack_t *stack) {
+	if(stack->locked) pthread_mutex_lock(&stack->lock);
+}
+void execute_stack_unlock(struct execute_stack_t *stack) {
+	if(stack->locked) pthread_mutex_unlock(&stack->lock);
+}
+
+//Makes room for one more slot in a full ring, moving its slots to a block twice the size with the top at the start. Returns 0 if there is no memory for it. The stack must be locked.
+char execute_stack_grow(struct execute_stack_t *stack) {
+	if(stack->count < stack->capacity) return 1;
+	struct execute_element_t *slots = malloc(sizeof(struct execute_element_t) * stack->capacity * 2);
+	if(slots == NULL) return 0;
+	uint64_t first = stack->capacity - stack->head < stack->count ? stack->capacity - stack->head : stack->count;
+	memcpy(slots, stack->slots + stack->head, sizeof(struct execute_element_t) * first);
+	memcpy(slots + first, stack->slots, sizeof(struct execute_element_t) * (stack->count - first));
+	free(stack->slots);
+	stack->slots = slots;
+	stack->head = 0;
+	stack->capacity *= 2;
+	return 1;
+}
+
+//Adds an element under the bottom of a stack, so that a statement queues up behind the ones not run yet.
+//On a ring the element is copied into a slot and its node freed, as it is for every way of adding to a ring.
+void execute_stack_enqueue(struct execute_stack_t *stack, struct execute_element_t *element) {
+	if(stack != NULL && element != NULL) {
+		element->next = NULL;
+		if(stack->slots != NULL) {
+			if(execute_stack_enqueue_value(stack, element)) slab_free(&execute_element_slab, element);
+			else execute_element_destroy(&element);
+			return;
+		}
+		pthread_mutex_lock(&stack->lock);
+		if(stack->bottom != NULL) stack->bottom->next = element;
+		else stack->top = element;
+		stack->bottom = element;
+		pthread_mutex_unlock(&stack->lock);
+	}
+}
+
+//Adds a copy of an element under the bottom of a stack, which then owns whatever the element points to. A list takes a node made for it, and a ring takes no allocation unless it is full.
+//Returns 0 without adding it if there is no memory for it.
+char execute_stack_enqueue_value(struct execute_stack_t *stack, const struct execute_element_t *element) {
+	char ret_val = 0;
+	if(stack != NULL && element != NULL) {
+		if(stack->slots != NULL) {
+			execute_stack_lock(stack);
+			ret_val = execute_stack_grow(stack);
+			if(ret_val) {
+				stack->slots[(stack->head + stack->count) & (stack->capacity - 1)] = *element;
+				++stack->count;
+			}
+			execute_stack_unlock(stack);
+		} else {
+			struct execute_element_t *node = slab_alloc(&execute_element_slab);
+			if(node != NULL) {
+				*node = *element;
+				execute_stack_enqueue(stack, node);
+				ret_val = 1;
+			}
+		}
+	}
+	return ret_val;
+}
+
+//Takes the element on top of a stack, copying it into the given one, which then owns whatever it points to. Returns 0 if the stack is empty.
+char execute_stack_pop_value(struct execute_stack_t *stack, struct execute_element_t *element) {
+	char ret_val = 0;
+	if(stack != NULL && element != NULL) {
+		if(stack->slots != NULL) {
+			execute_stack_lock(stack);
+			if(stack->count > 0) {
+				*element = stack->slots[stack->head];
+				stack->head = (stack->head + 1) & (stack->capacity - 1);
+				--stack->count;
+				ret_val = 1;
+			}
+			execute_stack_unlock(stack);
+		} else {
+			struct execute_element_t *node = execute_stack_pop(stack);
+			if(node != NULL) {
+				*element = *node;
+				slab_free(&execute_element_slab, node);
+				ret_val = 1;
+			}
+		}
+	}
+	return ret_val;
+}
+
+//Takes the element on top of a stack. An element taken from a ring is copied into a node made for it, and NULL is returned if there is no memory for it.
 struct execute_element_t *execute_stack_pop(struct execute_stack_t *stack) {
 	struct execute_element_t *ret_val = NULL;
-	if(stack != NULL) {	
+	if(stack != NULL && stack->slots != NULL) {
+		execute_stack_lock(stack);
+		if(stack->count > 0 && (ret_val = slab_alloc(&execute_element_slab)) != NULL) {
+			*ret_val = stack->slots[stack->head];
+			ret_val->next = NULL;
+			stack->head = (stack->head + 1) & (stack->capacity - 1);
+			--stack->count;
+		}
+		execute_stack_unlock(stack);
+	} else if(stack != NULL) {	
 		pthread_mutex_lock(&stack->lock);	
 		ret_val = stack->top;
 		if(stack->top != NULL) {
 			stack->top = stack->top->next;
 			ret_val->next = NULL;
+			if(stack->top == NULL) stack->bottom = NULL;
 		}
 		pthread_mutex_unlock(&stack->lock);
 	}
 	return ret_val;
 }
+
+//Returns the element on top of a stack without taking it. On a ring it is the slot itself, which stays good only until the stack next changes.
 struct execute_element_t *execute_stack_peek(struct execute_stack_t *stack) {
 	struct execute_element_t *ret_val = NULL;
-	if(stack != NULL) {
+	if(stack != NULL && stack->slots != NULL) {
+		execute_stack_lock(stack);
+		if(stack->count > 0) ret_val = &stack->slots[stack->head];
+		execute_stack_unlock(stack);
+	} else if(stack != NULL) {
 		pthread_mutex_lock(&stack->lock);
 		ret_val = stack->top;
 		pthread_mutex_unlock(&stack->lock);
@@ -177,23 +604,74 @@ struct execute_element_t *execute_stack_peek(struct execute_stack_t *stack) {
 	return ret_val;
 }
 void execute_stack_push(struct execute_stack_t *stack, struct execute_element_t *element) {
-	if(stack != NULL && element != NULL) {
+	if(stack != NULL && element != NULL && stack->slots != NULL) {
+		execute_stack_lock(stack);
+		char room = execute_stack_grow(stack);
+		if(room) {
+			stack->head = (stack->head - 1) & (stack->capacity - 1);
+			stack->slots[stack->head] = *element;
+			stack->slots[stack->head].next = NULL;
+			++stack->count;
+		}
+		execute_stack_unlock(stack);
+		if(room) slab_free(&execute_element_slab, element);
+		else execute_element_destroy(&element);
+	} else if(stack != NULL && element != NULL) {
 		pthread_mutex_lock(&stack->lock);
 		element->next = stack->top;
 		stack->top = element;
+		if(element->next == NULL) stack->bottom = element;
 		pthread_mutex_unlock(&stack->lock);
 	}
 }
 
+//Marks the given number of statements as complete on the stack and wakes the executor if it is parked.
+void execute_stack_publish(struct execute_stack_t *stack, uint64_t count) {
+	if(stack != NULL && count > 0) {
+		atomic_fetch_add_explicit(&stack->ready, count, memory_order_release);
+		wait_wake(&stack->wait);
+	}
+}
+
+//Marks that no more statements are coming and wakes the executor if it is parked. Must come after the last publish.
+void execute_stack_close(struct execute_stack_t *stack) {
+	if(stack != NULL) {
+		atomic_store_explicit(&stack->closed, 1, memory_order_release);
+		wait_wake(&stack->wait);
+	}
+}
+
 struct execute_stack_t *execute_stack_create() {
 	struct execute_stack_t *ret_val = malloc(sizeof(struct execute_stack_t));
 	if(ret_val != NULL) {
 		ret_val->top = NULL;
+		ret_val->bottom = NULL;
+		ret_val->slots = NULL;
+		ret_val->head = 0;
+		ret_val->count = 0;
+		ret_val->capacity = 0;
+		ret_val->locked = 1;
 		pthread_mutex_init(&ret_val->lock, NULL);
-		pthread_cond_init(&ret_val->exe_wait, NULL);
+		atomic_init(&ret_val->ready, 0);
+		atomic_init(&ret_val->closed, 0);
+		wait_init(&ret_val->wait);
+	}
+	return ret_val;
+}
+
+//Creates a stack kept as a ring of element slots, which grows as needed. A ring left unlocked may only be used by one thread at a time, as when one worker steps every stage of a pipeline.
+//Returns NULL if there is no memory for it.
+struct execute_stack_t *execute_stack_create_array(char locked) {
+	struct execute_stack_t *ret_val = execute_stack_create();
+	if(ret_val != NULL) {
+		ret_val->slots = malloc(sizeof(struct execute_element_t) * EXECUTE_STACK_SLOTS);
+		ret_val->capacity = EXECUTE_STACK_SLOTS;
+		ret_val->locked = locked;
+		if(ret_val->slots == NULL) execute_stack_destroy(&ret_val);
 	}
 	return ret_val;
 }
+
 void execute_stack_destroy(struct execute_stack_t **stack) {
 	if(stack != NULL) if(*stack != NULL) {
 		struct execute_element_t *temp = NULL;
@@ -201,8 +679,11 @@ void execute_stack_destroy(struct execute_stack_t **stack) {
 			temp = execute_stack_pop(*stack);
 			execute_element_destroy(&temp);
 		}
+		if((*stack)->slots != NULL) {
+			for(uint64_t count = 0; count < (*stack)->count; ++count) execute_element_clear(&(*stack)->slots[((*stack)->head + count) & ((*stack)->capacity - 1)]);
+			free((*stack)->slots);
+		}
 		pthread_mutex_destroy(&(*stack)->lock);
-		pthread_cond_destroy(&(*stack)->exe_wait);
 		free(*stack);
 	}
 }
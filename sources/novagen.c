@@ -0,0 +1,450 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novagen.c
+Purpose: Compiles a Nova grammar into the transition tables the parser uses. The build runs it on the grammar in novalang.h to write the tables Nova starts with, and it can compile a grammar file into a table a running parser loads.
+*/
+
+//Necessary imports.
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<ctype.h>
+#include<unistd.h>
+#include<endian.h>
+#include"novalang.h"
+
+//Values per line of a generated table.
+#define NOVA_GEN_LINE 16
+
+//Longest line of a grammar file.
+#define NOVA_GEN_MAX_LINE 4096
+
+//A production: a rule, the character it takes, and the rule it goes to.
+struct production_t {
+	unsigned char left;
+	unsigned char alpha;
+	unsigned char right;
+};
+
+//The grammar as its productions in the order they are written, and the tables compiled from them.
+//Characters that every rule treats the same share a class, and the last class is for every character outside the language.
+struct grammar_t {
+	struct production_t *prods;
+	int num_prods;
+	int max_prods;
+	int num_rules;
+	unsigned char context[NOVA_TABLE_MAX_RULES];
+	unsigned char classes[256];
+	unsigned char members[NOVA_TABLE_MAX_CLASSES];
+	int num_classes;
+	unsigned char *table;
+	unsigned char digit_loop[NOVA_TABLE_MAX_RULES];
+	int num_read;
+};
+
+//Private functions.
+char grammar_add(struct grammar_t *, const char *, const char *, int);
+char grammar_read(struct grammar_t *);
+char grammar_read_file(struct grammar_t *, const char *);
+char grammar_classify(struct grammar_t *);
+char grammar_resolve(struct grammar_t *);
+void grammar_minimize(struct grammar_t *);
+void grammar_loops(struct grammar_t *);
+void grammar_write(FILE *, const char *, const unsigned char *, int);
+char grammar_write_header(struct grammar_t *, const char *, const char *);
+char grammar_write_table(struct grammar_t *, const char *);
+void grammar_dump(struct grammar_t *, FILE *);
+
+//Adds a production written as "rule -> character, rule" to the grammar, from the given source and line for when it is wrong. A rule may go to the end marker.
+//Returns zero and says which production is wrong if it cannot be read or names a rule past the last one.
+char grammar_add(struct grammar_t *grammar, const char *text, const char *source, int line) {
+	int rule_left = -1, rule_right = -1, end = 0;
+	char alpha_char = '\0';
+	if(sscanf(text, " %d -> %c , %d %n", &rule_left, &alpha_char, &rule_right, &end) != 3 || text[end] != '\0' || rule_left < 0 || rule_left >= NOVA_TABLE_MAX_RULES || ((rule_right < 0 || rule_right >= NOVA_TABLE_MAX_RULES) && rule_right != NOVA_LANG_TERM)) {
+		fprintf(stderr, "%s:%d: Bad production \"%s\".\n", source, line, text);
+		return 0;
+	}
+	if(grammar->num_prods == grammar->max_prods) {
+		int max_prods = grammar->max_prods != 0 ? grammar->max_prods * 2 : NUM_NOVA_LANG_PRODS;
+		struct production_t *prods = realloc(grammar->prods, sizeof(struct production_t) * max_prods);
+		if(prods == NULL) {
+			perror(source);
+			return 0;
+		}
+		grammar->prods = prods;
+		grammar->max_prods = max_prods;
+	}
+	grammar->prods[grammar->num_prods].left = rule_left;
+	grammar->prods[grammar->num_prods].alpha = alpha_char;
+	grammar->prods[grammar->num_prods++].right = rule_right;
+	if(rule_left >= grammar->num_rules) grammar->num_rules = rule_left + 1;
+	if(rule_right != NOVA_LANG_TERM && rule_right >= grammar->num_rules) grammar->num_rules = rule_right + 1;
+	return 1;
+}
+
+//Reads the grammar in novalang.h.
+char grammar_read(struct grammar_t *grammar) {
+	char prod[NUM_NOVA_LANG_STR_LEN + 1];
+	for(int count = 0; count < NUM_NOVA_LANG_PRODS; ++count) {
+		memcpy(prod, NOVA_LANG_PRODS[count], NUM_NOVA_LANG_STR_LEN);
+		prod[NUM_NOVA_LANG_STR_LEN] = '\0';
+		if(!grammar_add(grammar, prod, "novalang.h", count + 1)) return 0;
+	}
+	memcpy(grammar->context, NOVA_LANG_CONTEXT, sizeof(NOVA_LANG_CONTEXT));
+	return 1;
+}
+
+//Reads a grammar file. Each line holds one production in the notation of novalang.h, or any number of them each in quotes, or gives a rule its context as "rule = context".
+//Rules not given a context have context zero. Blank lines and lines starting with # are skipped. Returns zero and says what is wrong if the file cannot be read.
+char grammar_read_file(struct grammar_t *grammar, const char *path) {
+	FILE *file = fopen(path, "r");
+	if(file == NULL) {
+		perror(path);
+		return 0;
+	}
+
+	char text[NOVA_GEN_MAX_LINE];
+	char ret_val = 1;
+	for(int line = 1; ret_val && fgets(text, sizeof(text), file) != NULL; ++line) {
+		text[strcspn(text, "\r\n")] = '\0';
+		char *start = text;
+		while(isspace((unsigned char)*start)) ++start;
+		int rule = -1, context = -1, end = 0;
+
+		if(*start == '\0' || *start == '#') continue;
+		else if(*start == '"') {
+
+			//Every quoted string on the line is a production, whatever is between them.
+			char *quote = start;
+			while(ret_val && quote != NULL) {
+				char *close = strchr(quote + 1, '"');
+				if(close == NULL) {
+					fprintf(stderr, "%s:%d: Unclosed quote.\n", path, line);
+					ret_val = 0;
+				} else {
+					*close = '\0';
+					ret_val = grammar_add(grammar, quote + 1, path, line);
+					quote = strchr(close + 1, '"');
+				}
+			}
+		} else if(sscanf(start, "%d = %d %n", &rule, &context, &end) == 2 && start[end] == '\0') {
+			if(rule < 0 || rule >= NOVA_TABLE_MAX_RULES || context < 0 || context > NOVA_LANG_CONTEXT_MAX) {
+				fprintf(stderr, "%s:%d: Bad context \"%s\".\n", path, line, start);
+				ret_val = 0;
+			} else grammar->context[rule] = context;
+		} else ret_val = grammar_add(grammar, start, path, line);
+	}
+	if(ferror(file)) {
+		perror(path);
+		ret_val = 0;
+	}
+	fclose(file);
+	if(ret_val && grammar->num_prods == 0) {
+		fprintf(stderr, "%s: No productions.\n", path);
+		ret_val = 0;
+	}
+	return ret_val;
+}
+
+//Puts characters in classes. Two characters share a class when every rule goes to the same rules, in the same order, on either of them, so the parser cannot tell them apart.
+//Returns zero if the memory for the comparison cannot be had, or if there are too many classes to number.
+char grammar_classify(struct grammar_t *grammar) {
+
+	//The productions on each character, sorted by rule and otherwise kept in order, are what tells it apart.
+	int *order = malloc(sizeof(int) * grammar->num_prods);
+	int *start = calloc(257, sizeof(int));
+	if(order == NULL || start == NULL) {
+		perror("novagen");
+		free(order);
+		free(start);
+		return 0;
+	}
+	for(int count = 0; count < grammar->num_prods; ++count) ++start[grammar->prods[count].alpha + 1];
+	for(int alpha = 0; alpha < 256; ++alpha) start[alpha + 1] += start[alpha];
+	int fill[256];
+	memcpy(fill, start, sizeof(fill));
+	for(int rule = 0; rule < grammar->num_rules; ++rule) {
+		for(int count = 0; count < grammar->num_prods; ++count) {
+			if(grammar->prods[count].left == rule) order[fill[grammar->prods[count].alpha]++] = count;
+		}
+	}
+
+	//Characters are numbered in ascending order, each taking the class of the first character like it.
+	grammar->num_classes = 0;
+	for(int alpha = 0; alpha < 256; ++alpha) {
+		int size = start[alpha + 1] - start[alpha];
+		grammar->classes[alpha] = NOVA_LANG_EMPTY;
+		if(size == 0) continue;
+		for(int other = 0; other < alpha && grammar->classes[alpha] == NOVA_LANG_EMPTY; ++other) {
+			if(start[other + 1] - start[other] != size || grammar->classes[other] == NOVA_LANG_EMPTY) continue;
+			int count = 0;
+			while(count < size && grammar->prods[order[start[alpha] + count]].left == grammar->prods[order[start[other] + count]].left && grammar->prods[order[start[alpha] + count]].right == grammar->prods[order[start[other] + count]].right) ++count;
+			if(count == size) grammar->classes[alpha] = grammar->classes[other];
+		}
+		if(grammar->classes[alpha] == NOVA_LANG_EMPTY) {
+			if(grammar->num_classes == NOVA_LANG_TERM) {
+				fprintf(stderr, "More than %d character classes.\n", NOVA_LANG_TERM - 1);
+				free(order);
+				free(start);
+				return 0;
+			}
+			grammar->members[grammar->num_classes] = alpha;
+			grammar->classes[alpha] = grammar->num_classes++;
+		}
+	}
+
+	//Every character outside the language has the class past the others.
+	for(int alpha = 0; alpha < 256; ++alpha) {
+		if(grammar->classes[alpha] == NOVA_LANG_EMPTY) grammar->classes[alpha] = grammar->num_classes;
+	}
+	++grammar->num_classes;
+	free(order);
+	free(start);
+	return 1;
+}
+
+//Resolves every rule, character and look ahead to the rule the parser goes to, the one of the rule's next rules that has a production on the look ahead.
+//The end rule has no productions, so a statement can only reach it on its last character, where the parser does not look ahead.
+//Returns zero and says where if more than one next rule has a production on the look ahead, since the parser could not know which to take.
+char grammar_resolve(struct grammar_t *grammar) {
+	int classes = grammar->num_classes;
+	grammar->table = malloc((size_t)grammar->num_rules * classes * classes);
+	char *has = calloc((size_t)grammar->num_rules * classes, 1);
+	if(grammar->table == NULL || has == NULL) {
+		perror("novagen");
+		free(has);
+		return 0;
+	}
+	memset(grammar->table, NOVA_LANG_EMPTY, (size_t)grammar->num_rules * classes * classes);
+	for(int count = 0; count < grammar->num_prods; ++count) has[grammar->prods[count].left * classes + grammar->classes[grammar->prods[count].alpha]] = 1;
+
+	char ret_val = 1;
+	for(int count = 0; count < grammar->num_prods; ++count) {
+		struct production_t *prod = &grammar->prods[count];
+		if(prod->right == NOVA_LANG_TERM) continue;
+		for(int ahead = 0; ahead < classes - 1; ++ahead) {
+			if(!has[prod->right * classes + ahead]) continue;
+			unsigned char *next = &grammar->table[(prod->left * classes + grammar->classes[prod->alpha]) * classes + ahead];
+			if(*next == NOVA_LANG_EMPTY) *next = prod->right;
+			else if(*next != prod->right) {
+				fprintf(stderr, "Rule %d on '%c' followed by '%c' can go to rule %d or rule %d.\n", prod->left, prod->alpha, grammar->members[ahead], *next, prod->right);
+				ret_val = 0;
+			}
+		}
+	}
+	free(has);
+	return ret_val;
+}
+
+//Minimizes the rules. Rules the first rule cannot reach are dropped, and rules that append the same context and go to the same rules on everything are merged.
+//The first rule stays first, and the others are numbered in the order they are written.
+void grammar_minimize(struct grammar_t *grammar) {
+	int classes = grammar->num_classes;
+	int cells = classes * classes;
+	unsigned char block[NOVA_TABLE_MAX_RULES];
+	unsigned char reached[NOVA_TABLE_MAX_RULES];
+	int stack[NOVA_TABLE_MAX_RULES];
+	int depth = 0;
+
+	//Find the rules reachable from the first.
+	memset(reached, 0, sizeof(reached));
+	reached[0] = 1;
+	stack[depth++] = 0;
+	while(depth > 0) {
+		int rule = stack[--depth];
+		for(int cell = 0; cell < cells; ++cell) {
+			unsigned char next = grammar->table[rule * cells + cell];
+			if(next != NOVA_LANG_EMPTY && !reached[next]) {
+				reached[next] = 1;
+				stack[depth++] = next;
+			}
+		}
+	}
+
+	//Start with a block for each context and split blocks until every rule in one goes to the same blocks.
+	int num_blocks = 0;
+	for(int rule = 0; rule < grammar->num_rules; ++rule) block[rule] = NOVA_LANG_EMPTY;
+	for(int rule = 0; rule < grammar->num_rules; ++rule) {
+		if(!reached[rule]) continue;
+		for(int other = 0; other < rule && block[rule] == NOVA_LANG_EMPTY; ++other) {
+			if(reached[other] && grammar->context[other] == grammar->context[rule]) block[rule] = block[other];
+		}
+		if(block[rule] == NOVA_LANG_EMPTY) block[rule] = num_blocks++;
+	}
+	int last_blocks = 0;
+	while(num_blocks != last_blocks) {
+		unsigned char split[NOVA_TABLE_MAX_RULES];
+		last_blocks = num_blocks;
+		num_blocks = 0;
+		for(int rule = 0; rule < grammar->num_rules; ++rule) {
+			split[rule] = NOVA_LANG_EMPTY;
+			if(!reached[rule]) continue;
+			for(int other = 0; other < rule && split[rule] == NOVA_LANG_EMPTY; ++other) {
+				if(!reached[other] || block[other] != block[rule]) continue;
+				int cell = 0;
+				while(cell < cells) {
+					unsigned char next = grammar->table[rule * cells + cell];
+					unsigned char next_other = grammar->table[other * cells + cell];
+					if((next == NOVA_LANG_EMPTY ? NOVA_LANG_EMPTY : block[next]) != (next_other == NOVA_LANG_EMPTY ? NOVA_LANG_EMPTY : block[next_other])) break;
+					++cell;
+				}
+				if(cell == cells) split[rule] = split[other];
+			}
+			if(split[rule] == NOVA_LANG_EMPTY) split[rule] = num_blocks++;
+		}
+		memcpy(block, split, sizeof(block));
+	}
+
+	//Each block becomes a rule, taking the table of the first rule in it.
+	int rule = 0;
+	for(int to = 0; to < num_blocks; ++to) {
+		while(block[rule] != to) ++rule;
+		for(int cell = 0; cell < cells; ++cell) {
+			unsigned char next = grammar->table[rule * cells + cell];
+			grammar->table[to * cells + cell] = next == NOVA_LANG_EMPTY ? NOVA_LANG_EMPTY : block[next];
+		}
+		grammar->context[to] = grammar->context[rule];
+	}
+	grammar->num_rules = num_blocks;
+}
+
+//Finds the rules that stay where they are on a digit followed by another digit, so the parser can pass over the inside of a number without the table.
+//The parser finds numbers by their digits alone, so no rule loops unless every digit is in the language.
+void grammar_loops(struct grammar_t *grammar) {
+	int classes = grammar->num_classes;
+	char digits = 1;
+	for(int alpha = '0'; alpha <= '9'; ++alpha) digits &= grammar->classes[alpha] != classes - 1;
+	for(int rule = 0; rule < grammar->num_rules; ++rule) {
+		grammar->digit_loop[rule] = digits;
+		for(int alpha = '0'; digits && alpha <= '9'; ++alpha) {
+			for(int ahead = '0'; ahead <= '9'; ++ahead) {
+				if(grammar->table[(rule * classes + grammar->classes[alpha]) * classes + grammar->classes[ahead]] != rule) grammar->digit_loop[rule] = 0;
+			}
+		}
+	}
+}
+
+//Writes a table as a static array.
+void grammar_write(FILE *file, const char *name, const unsigned char *table, int size) {
+	fprintf(file, "static const unsigned char %s[%d] = {", name, size);
+	for(int count = 0; count < size; ++count) {
+		if(count != 0) fprintf(file, ",");
+		fprintf(file, count % NOVA_GEN_LINE == 0 ? "\n\t%d" : " %d", table[count]);
+	}
+	fprintf(file, "\n};\n\n");
+}
+
+//Writes the tables into a header, noting where the grammar came from. Returns zero if the header cannot be written.
+char grammar_write_header(struct grammar_t *grammar, const char *path, const char *source) {
+	FILE *file = fopen(path, "w");
+	if(file == NULL) {
+		perror(path);
+		return 0;
+	}
+	fprintf(file, "//Generated by novagen from the grammar in %s. Do not edit.\n\n", source);
+	fprintf(file, "#ifndef NOVATAB_H\n#define NOVATAB_H\n\n");
+	fprintf(file, "//Rules after minimization, and character classes: one for each set of characters the rules treat the same, and one for every other character.\n");
+	fprintf(file, "#define NOVA_TABLE_RULES %d\n#define NOVA_TABLE_CLASSES %d\n\n", grammar->num_rules, grammar->num_classes);
+	fprintf(file, "//The class of every byte.\n");
+	grammar_write(file, "NOVA_TABLE_CLASS", grammar->classes, sizeof(grammar->classes));
+	fprintf(file, "//The rule the parser goes to, indexed by (rule * classes + character class) * classes + look ahead class. Empty where the statement is wrong.\n");
+	grammar_write(file, "NOVA_TABLE_NEXT", grammar->table, grammar->num_rules * grammar->num_classes * grammar->num_classes);
+	fprintf(file, "//The context each rule appends when the parser enters it.\n");
+	grammar_write(file, "NOVA_TABLE_CONTEXT", grammar->context, grammar->num_rules);
+	fprintf(file, "//Whether each rule goes back to itself on every digit followed by a digit.\n");
+	grammar_write(file, "NOVA_TABLE_DIGIT_LOOP", grammar->digit_loop, grammar->num_rules);
+	fprintf(file, "#endif\n");
+
+	if(fclose(file) != 0) {
+		perror(path);
+		remove(path);
+		return 0;
+	}
+	return 1;
+}
+
+//Writes the tables into a file in the format of novalang.h, for a running parser to load. Returns zero if the file cannot be written.
+char grammar_write_table(struct grammar_t *grammar, const char *path) {
+	FILE *file = fopen(path, "wb");
+	if(file == NULL) {
+		perror(path);
+		return 0;
+	}
+	struct nova_table_header_t header;
+	memcpy(header.magic, NOVA_TABLE_MAGIC, NOVA_TABLE_MAGIC_LEN);
+	header.num_rules = htole32(grammar->num_rules);
+	header.num_classes = htole32(grammar->num_classes);
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(grammar->classes, 1, sizeof(grammar->classes), file);
+	fwrite(grammar->table, 1, (size_t)grammar->num_rules * grammar->num_classes * grammar->num_classes, file);
+	fwrite(grammar->context, 1, grammar->num_rules, file);
+	fwrite(grammar->digit_loop, 1, grammar->num_rules, file);
+
+	if(ferror(file) | fclose(file)) {
+		perror(path);
+		remove(path);
+		return 0;
+	}
+	return 1;
+}
+
+//Writes the productions and contexts as a grammar file, to start a new grammar from.
+void grammar_dump(struct grammar_t *grammar, FILE *file) {
+	for(int count = 0; count < grammar->num_prods; ++count) {
+		fprintf(file, "%03d -> %c, %03d\n", grammar->prods[count].left, grammar->prods[count].alpha, grammar->prods[count].right);
+	}
+	for(int rule = 0; rule < grammar->num_rules; ++rule) {
+		if(grammar->context[rule] != 0) fprintf(file, "%03d = %d\n", rule, grammar->context[rule]);
+	}
+}
+
+//Compiles the grammar in novalang.h, or the grammar file given with -g, and writes a header with -c, a table file with -t, or the grammar itself with -d.
+//Nothing is written unless the grammar compiles.
+int main(int argc, char **argv) {
+	const char *grammar_path = NULL, *header_path = NULL, *table_path = NULL;
+	char dump = 0;
+	int option;
+	while((option = getopt(argc, argv, "g:c:t:d")) != -1) {
+		switch(option) {
+			case 'g':
+				grammar_path = optarg;
+				break;
+			case 'c':
+				header_path = optarg;
+				break;
+			case 't':
+				table_path = optarg;
+				break;
+			case 'd':
+				dump = 1;
+				break;
+			default:
+				header_path = table_path = NULL;
+				dump = 0;
+				optind = argc + 1;
+				break;
+		}
+	}
+	if(optind != argc || (header_path == NULL && table_path == NULL && !dump)) {
+		fprintf(stderr, "Usage: %s [-g grammar-file] [-c table-header] [-t table-file] [-d]\n", argv[0]);
+		return 1;
+	}
+
+	static struct grammar_t grammar;
+	if(!(grammar_path != NULL ? grammar_read_file(&grammar, grammar_path) : grammar_read(&grammar))) return 1;
+	if(dump) grammar_dump(&grammar, stdout);
+	if(header_path == NULL && table_path == NULL) return 0;
+
+	grammar.num_read = grammar.num_rules;
+	if(!grammar_classify(&grammar) || !grammar_resolve(&grammar)) return 1;
+	grammar_minimize(&grammar);
+	grammar_loops(&grammar);
+
+	if(header_path != NULL && !grammar_write_header(&grammar, header_path, grammar_path != NULL ? grammar_path : "novalang.h")) return 1;
+	if(table_path != NULL) {
+		if(!grammar_write_table(&grammar, table_path)) return 1;
+		fprintf(stderr, "%s: %d rules, %d after minimization, %d character classes.\n", table_path, grammar.num_read, grammar.num_rules, grammar.num_classes);
+	}
+	return 0;
+}
@@ -7,9 +7,12 @@ Purpose: To implement all things input related. Uses locks to gatekeep access to
 
 //Necessary imports.
 #include"novain.h"
+#include<unistd.h>
+#include<errno.h>
 
 //Private functions.
-void write_out(struct input_t *, uint64_t, int *, uint64_t *);
+char write_out(struct input_t *, uint64_t, int *, uint64_t *);
+char read_out(struct input_t *, uint64_t, int *, uint64_t *);
 
 //Creates input node
 struct input_t *input_create() {
@@ -19,6 +22,7 @@ struct input_t *input_create() {
 		ret_val->in_file = NULL;
 		ret_val->out_buf = NULL;
 		pthread_mutex_init(&ret_val->lock, NULL);
+		ret_val->mode = INPUT_MODE_BLOCK;
 		ret_val->cont_flag = 1;
 	}
 	return ret_val;
@@ -71,6 +75,21 @@ struct buffer_t *input_set_out(struct input_t *input, struct buffer_t *buf) {
 	return ret_val;
 }
 
+//Takes in a mode and an input node, sets the input mode of the node to the mode provided, and returns whatever the old mode was.
+char input_set_mode(struct input_t *input, char mode) {
+
+	char ret_val = INPUT_MODE_CHAR;
+	if(input != NULL) {
+
+		//Set the return variable to the current value.
+		ret_val = input->mode;
+
+		//Set the new value.
+		input->mode = mode;
+	}
+	return ret_val;
+}
+
 //Do reading from input to buffer. A thread will run this until program termination or until it is put to sleep when it has no work and is to be awoken later to either work or terminate.
 void *do_in(void *input_ptr) {
 
@@ -90,48 +109,86 @@ void *do_in(void *input_ptr) {
 			//Loop until termination signal
 			while(input->cont_flag) {
 				
-				//Lock the buffer. Do control logic.
-				buffer_write_lock(buf);	
+				//Reserve space in the buffer. Do control logic.
+				buffer_reserve(buf, 1);
 
-				//If read is ahead of write, write until read.
-				if(buf->cursor_write < buf->cursor_read) write_out(input, buf->cursor_read - buf->cursor_write, &current, &diff);
-				//If read is behind write, write until end.
-				else write_out(input, buf->end - buf->cursor_write, &current, &diff);
-				//Update the cursor.
-				buf->cursor_write += diff;
+				//Write across the whole writable span. Reading stops the node at the end of the file.
+				if(input->mode == INPUT_MODE_BLOCK) input->cont_flag = read_out(input, buffer_write_span(buf), &current, &diff);
+				else input->cont_flag = write_out(input, buffer_write_span(buf), &current, &diff);
 
-				//Unlock buffer. Do control logic.
-				buffer_write_unlock(buf, diff);
+				//Publish what was written. Do control logic.
+				buffer_commit(buf, diff);
 
 				//Reset the cursor counter.
 				diff = 0;
 			}
+
+			//Tell the parser there is no more input, so it can finish and stop.
+			buffer_close(buf);
 		}
 	}
 	pthread_exit(NULL);
 }
 
-//Write from input to buffer buf up to max_size characters, using the provided character holder and counter.
-void write_out(struct input_t *input, uint64_t max_size, int *current, uint64_t *diff) {
+//Write from input to buffer buf up to max_size characters, using the provided character holder and counter. Returns 0 once the end of the file has been reached.
+char write_out(struct input_t *input, uint64_t max_size, int *current, uint64_t *diff) {
+
+	char ret_val = 1;
 
 	//Get lock on the input file, and loop until the read cursor has been reached. 
 	pthread_mutex_lock(&input->lock);
 	while(*diff < max_size) {
 
-		//Unlocks the buffer lock, to enable output to do work while there is any I/O latency.
-		pthread_mutex_unlock(&input->out_buf->lock);
+		//Unlocks the buffer lock, to enable output to do work while there is any I/O latency. Lock-free buffers hold no lock.
+		if(input->out_buf->mode == BUFFER_MODE_LOCKED) pthread_mutex_unlock(&input->out_buf->lock);
 		//Gets input of one character.
 		*current = fgetc(input->in_file);	
-		//Checks if character is a line end or a carriage return, if so replace with a null character to indicate end of input.
-		if(*current == '\n' || *current == '\r') {
+		//Checks if character is a line end, a carriage return, or the end of the file. If so replace with a null character to indicate end of input.
+		if(*current == EOF) ret_val = 0;
+		if(*current == '\n' || *current == '\r' || *current == EOF) {
 			*((char *)(input->out_buf->cursor_write + (*diff)++)) = '\0';
 			break;
 		}
 		//Relock the buffer and write to the buffer.
-		pthread_mutex_lock(&input->out_buf->lock);
+		if(input->out_buf->mode == BUFFER_MODE_LOCKED) pthread_mutex_lock(&input->out_buf->lock);
 		*((char *)(input->out_buf->cursor_write + (*diff)++)) = *((char *)current);
 	}
 
 	//Unlock the file.
 	pthread_mutex_unlock(&input->lock);
+	return ret_val;
+}
+
+//Read a block from input into buffer buf of up to max_size characters, using the provided character holder for the last character read and the provided counter.
+//Line ends and carriage returns are replaced with null characters to mark the end of each statement. Returns 0 once the end of the file has been reached.
+char read_out(struct input_t *input, uint64_t max_size, int *current, uint64_t *diff) {
+
+	char ret_val = 1;
+	char *cursor = (char *)input->out_buf->cursor_write;
+	ssize_t count = 0;
+
+	//Get lock on the input file, and unlock the buffer lock while waiting on the read. Lock-free buffers hold no lock.
+	pthread_mutex_lock(&input->lock);
+	if(input->out_buf->mode == BUFFER_MODE_LOCKED) pthread_mutex_unlock(&input->out_buf->lock);
+	do count = read(fileno(input->in_file), cursor, max_size);
+	while(count < 0 && errno == EINTR);
+	if(input->out_buf->mode == BUFFER_MODE_LOCKED) pthread_mutex_lock(&input->out_buf->lock);
+
+	//Mark the statement ends in the block.
+	if(count > 0) {
+		for(ssize_t i = 0; i < count; ++i) {
+			if(cursor[i] == '\n' || cursor[i] == '\r') cursor[i] = '\0';
+		}
+		*current = cursor[count - 1];
+		*diff += count;
+
+	//At the end of the file, or on an error reading it, end a last statement left without a line end and stop.
+	} else {
+		if(*current != '\0') cursor[(*diff)++] = '\0';
+		ret_val = 0;
+	}
+
+	//Unlock the file.
+	pthread_mutex_unlock(&input->lock);
+	return ret_val;
 }
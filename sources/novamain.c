@@ -9,42 +9,290 @@ Purpose: To serve as the entry point to the Nova program.
 #include<stdio.h>
 #include<stdlib.h>
 #include<pthread.h>
+#include<signal.h>
+#include<unistd.h>
 #include"novapipe.h"
 #include"novain.h"
 #include"novaout.h"
 #include"novacmp.h"
 #include"novaexe.h"
+#include"novactl.h"
+#include"novasrv.h"
+#include"novabat.h"
 
-const int NUM_PIPE_THREADS = 4;
-const int BUFFER_SIZE = 1024;
+const int NUM_PIPE_THREADS = 5;
+
+//How often and how many times a producer tries to attach to the rings of a server that is still starting.
+const int SHM_ATTACH_TRIES = 500;
+const int SHM_ATTACH_WAIT_US = 10000;
+
+//Prints the telemetry of every registered buffer, of the executor, and of the slabs its elements come from whenever the process receives SIGUSR1.
+void *do_report(void *stack_ptr) {
+	sigset_t signals;
+	int signal = 0;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGUSR1);
+	while(sigwait(&signals, &signal) == 0) {
+		buffer_report_all(stderr);
+		if(stack_ptr != NULL) wait_report(stderr, "execute waits", &((struct execute_stack_t *)stack_ptr)->wait);
+		execute_report_slabs(stderr);
+	}
+	return NULL;
+}
+
+//Blocks SIGUSR1 in the calling thread and every thread it starts from then on, and leaves the signal to a reporting thread. The execution stack may be NULL where a process has no single one.
+void report_start(struct execute_stack_t *stack) {
+	pthread_t report_thread;
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+	if(pthread_create(&report_thread, NULL, do_report, (void *)stack) == 0) pthread_detach(report_thread);
+}
+
+//Loads the grammar table file at the given path and puts it in place of the one the parsers run on. Says so if it cannot be loaded, and the old table stays in use.
+char grammar_reload(const char *path) {
+	struct lang_table_t *table = lang_table_load(path);
+	if(table != NULL) lang_table_swap(table);
+	else fprintf(stderr, "Could not load the grammar table %s\n", path);
+	return table != NULL;
+}
+
+//Loads the configured grammar table again whenever the process receives SIGHUP, so that a grammar can be changed without stopping the pipelines.
+void *do_reload(void *control_ptr) {
+	sigset_t signals;
+	int signal = 0;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGHUP);
+	while(sigwait(&signals, &signal) == 0) grammar_reload(((struct control_t *)control_ptr)->grammar);
+	return NULL;
+}
+
+//Names the shared memory ring with the given suffix, for a configured ring name.
+void shm_ring_name(char *name, const char *base, const char *suffix) {
+	snprintf(name, BUFFER_NAME_SIZE, "/%s%s", base, suffix);
+}
+
+//Attaches to a shared memory ring, waiting for the server to create it.
+struct buffer_t *shm_attach(const char *name) {
+	struct buffer_t *ret_val = NULL;
+	for(int i = 0; ret_val == NULL && i < SHM_ATTACH_TRIES; ++i) {
+		ret_val = buffer_create_shared(name, 1, 0);
+		if(ret_val == NULL) usleep(SHM_ATTACH_WAIT_US);
+	}
+	return ret_val;
+}
+
+//Runs as a producer for a Nova server on the same machine. Standard input is fed to the input ring of the server by an input node, and the results are copied from its output ring to standard output.
+//Returns the exit code of the program.
+int run_producer(struct control_t *control) {
+	int ret_val = 1;
+	char name[BUFFER_NAME_SIZE];
+	shm_ring_name(name, control->shm, ".in");
+	struct buffer_t *ring_in = shm_attach(name);
+	shm_ring_name(name, control->shm, ".out");
+	struct buffer_t *ring_out = ring_in != NULL ? shm_attach(name) : NULL;
+	struct input_t *input = input_create();
+	pthread_t input_thread;
+	if(ring_in != NULL && ring_out != NULL && input != NULL) {
+		input_set_in(input, stdin);
+		input_set_out(input, ring_in);
+		input_set_mode(input, control->input_block ? INPUT_MODE_BLOCK : INPUT_MODE_CHAR);
+		if(pthread_create(&input_thread, NULL, do_in, (void *)input) == 0) {
+
+			//Copy results until the server closes its output ring.
+			while(1) {
+				buffer_peek(ring_out, 1);
+				if(buffer_drained(ring_out)) break;
+				uint64_t span = buffer_read_span(ring_out);
+				fwrite(ring_out->cursor_read, 1, span, stdout);
+				buffer_consume(ring_out, span);
+			}
+			fflush(stdout);
+			pthread_join(input_thread, NULL);
+			ret_val = 0;
+		}
+	} else fprintf(stderr, "Could not attach to the shared memory rings of %s\n", control->shm);
+	input_destroy(&input);
+	buffer_destroy(&ring_in);
+	buffer_destroy(&ring_out);
+	return ret_val;
+}
+
+//Serves sessions on a Unix domain socket until the process is interrupted or terminated. Returns the exit code of the program.
+int run_server(struct control_t *control) {
+	int ret_val = 1;
+
+	//Take the stopping signals in this thread only, so the workers are not interrupted by them.
+	sigset_t signals;
+	int signal = 0;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	//Reports are taken the same way as in the single pipeline, before any session worker starts.
+	report_start(NULL);
+	struct server_t *server = server_create(control->listen, control->buffer_size, control->output_format, control->workers);
+	if(server != NULL) {
+		if(server_start(server)) {
+			fprintf(stderr, "Serving on %s with %d workers\n", control->listen, control->workers);
+			sigwait(&signals, &signal);
+			ret_val = 0;
+		} else fprintf(stderr, "Could not start the workers\n");
+		server_stop(server);
+		server_destroy(&server);
+	} else fprintf(stderr, "Could not listen on %s\n", control->listen);
+	return ret_val;
+}
+
+//Runs a script on a pool of workers. The script is split into chunks at line ends, each chunk runs through a pipeline of its own on whichever worker takes it, and the results are gathered back in order for the output node.
+//Returns the exit code of the program.
+int run_batch(struct control_t *control, const char *script) {
+	int ret_val = 1;
+	struct buffer_t *buffer_in = buffer_create_file(script);
+	struct buffer_t *buffer_out = buffer_create_mirror(control->buffer_size);
+	struct output_t *output = output_create();
+	struct batch_t *batch = NULL;
+	pthread_t gather_thread, output_thread;
+	if(buffer_in == NULL) fprintf(stderr, "Could not read script %s\n", script);
+	else if(buffer_out != NULL && output != NULL) batch = batch_create(buffer_in, buffer_out, control->buffer_size, control->output_format, control->workers);
+	if(batch != NULL) {
+		output_set_in(output, buffer_out);
+		output_set_out(output, stdout);
+		output_set_latency(output, control->flush_latency);
+		report_start(NULL);
+		if(batch_start(batch)) {
+			pthread_create(&gather_thread, NULL, do_gather, (void *)batch);
+			pthread_create(&output_thread, NULL, do_out, (void *)output);
+			pthread_join(gather_thread, NULL);
+			pthread_join(output_thread, NULL);
+			ret_val = 0;
+		} else fprintf(stderr, "Could not start the workers\n");
+		batch_join(batch);
+		batch_destroy(&batch);
+	}
+	output_destroy(&output);
+	buffer_destroy(&buffer_in);
+	buffer_destroy(&buffer_out);
+	return ret_val;
+}
 
 //A temporarily empty main method. Will serve as the entry point to the Nova program.
-int main() {
+int main(int argc, char **argv) {
 
-	//Print console header.
-	printf("\n\nNova 0.0.0\n\n");
+	//Read the configuration: the defaults, then the file named in the environment, then the command line.
+	struct control_t *control = control_create();
+	if(control == NULL) return 1;
+	//At most one argument is left after the options, naming a script file to run instead of reading standard input. Servers and producers take none.
+	int first_arg = control_load_env(control) ? control_parse_args(control, argc, argv) : -1;
+	if(first_arg < 0 || argc - first_arg > (control->shm[0] != '\0' || control->listen[0] != '\0' ? 0 : 1)) {
+		control_usage(stderr, argv[0]);
+		control_destroy(&control);
+		return 1;
+	}
+
+	//The controller never shrinks a buffer below one block of results, so that a block always fits in the output buffer.
+	if(control->buffer_min < EXECUTE_BLOCK_SIZE) control->buffer_min = EXECUTE_BLOCK_SIZE;
+
+	//Start on the configured grammar table. SIGHUP is blocked in every thread and left to a thread that loads the table again.
+	if(control->grammar[0] != '\0') {
+		if(!grammar_reload(control->grammar)) {
+			control_destroy(&control);
+			return 1;
+		}
+		pthread_t reload_thread;
+		sigset_t signals;
+		sigemptyset(&signals);
+		sigaddset(&signals, SIGHUP);
+		pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+		//The reloading thread also keeps SIGUSR1 blocked, as it starts before the reporting thread takes that signal over.
+		sigaddset(&signals, SIGUSR1);
+		sigset_t mask;
+		pthread_sigmask(SIG_BLOCK, &signals, &mask);
+		if(pthread_create(&reload_thread, NULL, do_reload, (void *)control) == 0) pthread_detach(reload_thread);
+		pthread_sigmask(SIG_SETMASK, &mask, NULL);
+	}
+
+	//A producer only feeds a server, and runs no pipeline of its own. A socket server runs a pipeline for each session instead.
+	if((control->shm[0] != '\0' && control->shm_producer) || control->listen[0] != '\0') {
+		int exit_code = control->listen[0] != '\0' ? run_server(control) : run_producer(control);
+		lang_table_release();
+		execute_release_slabs();
+		control_destroy(&control);
+		return exit_code;
+	}
+
+	//Print console header. It goes out before the output node starts writing to the same file. Binary output has no room for it.
+	char text = control->output_format == OUTPUT_FORMAT_TEXT;
+	if(text) printf("\n\nNova 0.0.0\n\n");
+	fflush(stdout);
+
+	//A script given more than one worker is run in chunks side by side instead of through the one pipeline.
+	if(first_arg < argc && control->workers > 1) {
+		int exit_code = run_batch(control, argv[first_arg]);
+		lang_table_release();
+		execute_release_slabs();
+		control_destroy(&control);
+		if(text) printf("\n\n");
+		return exit_code;
+	}
 
 	//Create thread pool.
 	pthread_t *threads = malloc(sizeof(pthread_t) * NUM_PIPE_THREADS);
 
 	//Create shared pipeline elements.
-	struct buffer_t *buffer_in = buffer_create(BUFFER_SIZE);
-	struct buffer_t *buffer_parse = buffer_create(BUFFER_SIZE);
+	//The input to parse and parse to interpret links each have a single writer and a single reader thread, so they use lock-free buffers.
+	//They are mirrored so that the stages always see whole spans.
+	//A script file is mapped and handed to the parser as a full input buffer, and the input node is not run.
+	//The executor writes results to the output buffer, and the output node writes them out in batches.
+	//As a server, the input buffer and the output buffer are shared memory rings that a producer process writes statements to and reads results from, and neither the input node nor the output node is run.
+	const char *script = first_arg < argc ? argv[first_arg] : NULL;
+	char server = control->shm[0] != '\0';
+	struct buffer_t *buffer_in = NULL;
+	struct buffer_t *buffer_out = NULL;
+	if(server) {
+		char name[BUFFER_NAME_SIZE];
+		shm_ring_name(name, control->shm, ".in");
+		buffer_in = buffer_create_shared(name, control->buffer_size, 1);
+		shm_ring_name(name, control->shm, ".out");
+		buffer_out = buffer_create_shared(name, control->buffer_size, 1);
+		if(buffer_in == NULL || buffer_out == NULL) fprintf(stderr, "Could not create the shared memory rings of %s\n", control->shm);
+	} else if(script != NULL) {
+		buffer_in = buffer_create_file(script);
+		if(buffer_in == NULL) fprintf(stderr, "Could not read script %s\n", script);
+	} else buffer_in = buffer_create_mirror(control->buffer_size);
+	if(!server) buffer_out = buffer_create_mirror(control->buffer_size);
+	struct buffer_t *buffer_parse = buffer_create_mirror(control->buffer_size);
 	struct context_queue_t *context_queue = context_queue_create();
-	struct execute_stack_t *execute_stack = execute_stack_create();
+	struct execute_stack_t *execute_stack = execute_stack_create_array(1);
 
 	//Create pipeline nodes.
 	struct input_t *input = input_create();
 	struct parse_t *parse = parse_create();
 	struct interpret_t *interpret = interpret_create();
 	struct execute_t *execute = execute_create();
+	struct output_t *output = output_create();
 
 	//Before proceeding, check that the thread pool, the pipeline elements, and the pipeline nodes are all non null.
-	if(threads != NULL && input != NULL && parse != NULL && interpret != NULL && execute != NULL && buffer_in != NULL && buffer_parse != NULL && context_queue != NULL && execute_stack != NULL) {
+	int exit_code = 1;
+	if(threads != NULL && input != NULL && parse != NULL && interpret != NULL && execute != NULL && buffer_in != NULL && buffer_parse != NULL && context_queue != NULL && execute_stack != NULL && buffer_out != NULL && output != NULL) {
+
+		//Name the buffers so that their telemetry can be looked up.
+		buffer_register(buffer_in, "input");
+		buffer_register(buffer_parse, "parse");
+		buffer_register(buffer_out, "output");
+
+		//Hand the lock-free buffers to the controller, which resizes them as the load changes.
+		control_add_buffer(control, buffer_in);
+		control_add_buffer(control, buffer_parse);
+		control_add_buffer(control, buffer_out);
 
 		//Set up input node.
 		input_set_in(input, stdin);
 		input_set_out(input, buffer_in);
+		input_set_mode(input, control->input_block ? INPUT_MODE_BLOCK : INPUT_MODE_CHAR);
 
 		//Set up parse node.
 		parse_set_in(parse, buffer_in);
@@ -58,15 +306,37 @@ int main() {
 		
 		//Set up execute node.
 		execute_set_stack(execute, execute_stack);
+		execute_set_out(execute, buffer_out);
+		execute_set_format(execute, control->output_format);
+
+		//Set up output node.
+		output_set_in(output, buffer_out);
+		output_set_out(output, stdout);
+		output_set_latency(output, control->flush_latency);
+
+		//Block SIGUSR1 in every thread, and leave it to a reporting thread.
+		report_start(execute_stack);
+
+		//Start the controller unless adapting has been turned off.
+		pthread_t control_thread;
+		char control_started = control->adaptive && pthread_create(&control_thread, NULL, do_control, (void *)control) == 0;
 
 		//Activate pipeline nodes by starting off thread pool.
-		pthread_create(&threads[0], NULL, do_in, (void *)input);
+		int first_thread = script != NULL || server;
+		if(first_thread == 0) pthread_create(&threads[0], NULL, do_in, (void *)input);
 		pthread_create(&threads[1], NULL, do_parse, (void *)parse);
 		pthread_create(&threads[2], NULL, do_interpret, (void *)interpret);
 		pthread_create(&threads[3], NULL, do_execute, (void *)execute);
+		int last_thread = server ? NUM_PIPE_THREADS - 1 : NUM_PIPE_THREADS;
+		if(!server) pthread_create(&threads[4], NULL, do_out, (void *)output);
 
-		//Wait for pipeline nodes to stop.
-		for(int i = 0; i < NUM_PIPE_THREADS; ++i) pthread_join(threads[i], NULL);
+		//Wait for pipeline nodes to stop. Each stops once the one before it has and it has finished the work left to it.
+		for(int i = first_thread; i < last_thread; ++i) pthread_join(threads[i], NULL);
+
+		//Stop the controller before the buffers it watches go away.
+		control_stop(control);
+		if(control_started) pthread_join(control_thread, NULL);
+		exit_code = 0;
 	}
 
 	//Afterward, teardown, whether successful or not.
@@ -77,19 +347,26 @@ int main() {
 	parse_destroy(&parse);
 	interpret_destroy(&interpret);
 	execute_destroy(&execute);
+	output_destroy(&output);
 
 	//Free shared pipeline elements.
 	buffer_destroy(&buffer_in);
 	buffer_destroy(&buffer_parse);
+	buffer_destroy(&buffer_out);
 	context_queue_destroy(&context_queue);
 	execute_stack_destroy(&execute_stack);
 
+	//Free the grammar tables, the slabs and the configuration.
+	lang_table_release();
+	execute_release_slabs();
+	control_destroy(&control);
+
 	//Free thread pool.
 	if(threads != NULL) free(threads);
 
 	//Print space.
-	printf("\n\n");
+	if(text) printf("\n\n");
 
-	//End program.
-	pthread_exit(NULL);
+	//End program. Returning also ends the reporting thread.
+	return exit_code;
 }
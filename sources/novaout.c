@@ -7,9 +7,17 @@ Purpose: To implement all things output related. Uses locks to gatekeep access t
 
 //Necessary imports.
 #include"novaout.h"
+#include<unistd.h>
+#include<errno.h>
+#include<string.h>
+#include<endian.h>
+
+//Pairs of decimal digits, so that numbers are written two digits at a time.
+static const char OUTPUT_DIGIT_PAIRS[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
 
 //Private functions.
-void read_in(struct output_t *, uint64_t, int *, uint64_t *);
+void read_in(struct output_t *, uint64_t *);
+int output_digits(uint32_t);
 
 //Creates an output node.
 struct output_t *output_create() {
@@ -19,6 +27,7 @@ struct output_t *output_create() {
 		ret_val->out_file = NULL;
 		ret_val->in_buf = NULL;
 		pthread_mutex_init(&ret_val->lock, NULL);
+		ret_val->latency = OUTPUT_LATENCY;
 		ret_val->cont_flag = 1;
 	}
 	return ret_val;
@@ -60,8 +69,8 @@ FILE *output_set_out(struct output_t *output, FILE *file) {
 		//Get return value.
 		ret_val = output->out_file;
 
-		//Remove any native buffers. Buffering is done by nova.
-		if(file != NULL) setbuf(file, NULL);
+		//Send out anything the file has buffered. The node writes to the file descriptor directly, and buffering is done by nova.
+		if(file != NULL) fflush(file);
 
 		//Set new value.
 		output->out_file = file;
@@ -69,6 +78,21 @@ FILE *output_set_out(struct output_t *output, FILE *file) {
 	return ret_val;
 }
 
+//Takes in a latency bound in microseconds and an output node, sets how long the node may hold output back to gather more, and returns whatever the old bound was.
+//A bound of 0 writes output as soon as it is there.
+uint64_t output_set_latency(struct output_t *output, uint64_t latency) {
+	uint64_t ret_val = 0;
+	if(output != NULL) {
+
+		//Get return value.
+		ret_val = output->latency;
+
+		//Set new value.
+		output->latency = latency;
+	}
+	return ret_val;
+}
+
 //Do writing from buffer to output. A thread will run this until program termination or until it is put to sleep when it has no work and is to be awoken later to either work or terminate.
 void *do_out(void *output_ptr) {
 
@@ -82,25 +106,28 @@ void *do_out(void *output_ptr) {
 		if(buf != NULL) {
 
 			//Variables on the stack to be used by this thread during output runtime.
-			int current = 0;
 			uint64_t diff = 0;
 
 			//Loop until program termination begins.
 			while(output->cont_flag) {
 
-				//Lock the buffer. Do control logic.
-				buffer_read_lock(buf);	
+				//Wait for something to read. Do control logic.
+				buffer_peek(buf, 1);
+
+				//Stop once the executor is done and everything it wrote is out.
+				if(buffer_drained(buf)) {
+					buffer_consume(buf, 0);
+					break;
+				}
+
+				//Give the executor up to the latency bound to add more, so that it goes out in one write. Half a buffer is enough to go on with.
+				if(output->latency > 0 && buf->mode == BUFFER_MODE_SPSC) buffer_peek_timed(buf, buf->size_read / 2, output->latency * 1000);
 
-				//Check if write is ahead of read, if so read until write is reached.
-				if(buf->cursor_write > buf->cursor_read) read_in(output, buf->cursor_write - buf->cursor_read, &current, &diff);	
-				//Otherwise, the read is ahead of write, if so read until end of buffer.
-				else read_in(output, buf->end - buf->cursor_read, &current, &diff);
-				//Update the cursor.
-				buf->cursor_read += diff;
-				fflush(output->out_file);
+				//Write out everything readable.
+				read_in(output, &diff);
 
-				//Unlock the buffer. Do control logic.
-				buffer_read_unlock(buf, diff);
+				//Release what was read. Do control logic.
+				buffer_consume(buf, diff);
 
 				//Reset cursor counter.
 				diff = 0;
@@ -110,22 +137,104 @@ void *do_out(void *output_ptr) {
 	pthread_exit(NULL);
 }
 
-//Do read into the output stream from the buffer upto max_size characters, from buffer buf to the provided output using the provided character and counter variables.
-void read_in(struct output_t *output, uint64_t max_size, int *current, uint64_t *diff) {
-	
-	//Obtain a lock on the output file, and loop until the write cursor has been reached.
+//Write everything readable in the buffer to the output file with as few calls as it takes, and add the bytes written to the provided counter.
+//Bytes that cannot be written because of an error are counted as well and dropped, so that a closed output never holds up the executor.
+void read_in(struct output_t *output, uint64_t *diff) {
+	struct iovec iov[2];
+	int count = buffer_read_vec(output->in_buf, iov);
+	ssize_t written = 0;
+
+	//Obtain a lock on the output file, and unlock the buffer lock while writing. Lock-free buffers hold no lock.
 	pthread_mutex_lock(&output->lock);
-	while(*diff < max_size) {
-		//Get the current character from the buffer.
-		*current = (int)*((char *)(output->in_buf->cursor_read + (*diff)++));
-		//Unlock the buffer, to enable input to interact with it in the case of I/O delays.
-		pthread_mutex_unlock(&output->in_buf->lock);
-		//Put the current character onto the file.
-		fputc(*current, output->out_file);
-		//Relock the buffer.
-		pthread_mutex_lock(&output->in_buf->lock);
+	if(output->in_buf->mode == BUFFER_MODE_LOCKED) pthread_mutex_unlock(&output->in_buf->lock);
+	while(count > 0) {
+		do written = writev(fileno(output->out_file), iov, count);
+		while(written < 0 && errno == EINTR);
+
+		//Drop the rest on an error.
+		if(written < 0) {
+			written = 0;
+			for(int i = 0; i < count; ++i) written += iov[i].iov_len;
+		}
+
+		//Move past what was written, which may end part way through a vector.
+		*diff += written;
+		while(count > 0 && (size_t)written >= iov[0].iov_len) {
+			written -= iov[0].iov_len;
+			iov[0] = iov[1];
+			--count;
+		}
+		if(count > 0) {
+			iov[0].iov_base += written;
+			iov[0].iov_len -= written;
+		}
 	}
+	if(output->in_buf->mode == BUFFER_MODE_LOCKED) pthread_mutex_lock(&output->in_buf->lock);
 
 	//Unlock the file.
 	pthread_mutex_unlock(&output->lock);
 }
+
+//Writes an integer in decimal at the destination, with no line end. The destination must have room for OUTPUT_INT_SIZE characters. Returns how many were written.
+//The digits are counted first so that they can be written from the back, two at a time.
+uint64_t output_format_int(char *dest, int value) {
+	uint64_t ret_val = 0;
+
+	//Work on the magnitude unsigned, which also holds the most negative value.
+	uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+	if(value < 0) dest[ret_val++] = '-';
+	int digits = output_digits(magnitude);
+	char *cursor = dest + ret_val + digits;
+	ret_val += digits;
+	while(magnitude >= 100) {
+		const char *pair = OUTPUT_DIGIT_PAIRS + (magnitude % 100) * 2;
+		magnitude /= 100;
+		cursor -= 2;
+		cursor[0] = pair[0];
+		cursor[1] = pair[1];
+	}
+	if(magnitude >= 10) {
+		cursor -= 2;
+		cursor[0] = OUTPUT_DIGIT_PAIRS[magnitude * 2];
+		cursor[1] = OUTPUT_DIGIT_PAIRS[magnitude * 2 + 1];
+	} else *--cursor = '0' + magnitude;
+	return ret_val;
+}
+
+//Writes a batch of integers at the destination as one block, each on a line of its own. The destination must have room for OUTPUT_INT_SIZE characters for each. Returns how many were written.
+uint64_t output_format_ints(char *dest, const int *values, uint64_t count) {
+	uint64_t ret_val = 0;
+	for(uint64_t i = 0; i < count; ++i) {
+		ret_val += output_format_int(dest + ret_val, values[i]);
+		dest[ret_val++] = '\n';
+	}
+	return ret_val;
+}
+
+//Writes a batch of results at the destination as one binary frame, each result with the sequence number of its statement and its status. The destination must have room for OUTPUT_FRAME_SIZE of the count.
+//Returns how many bytes were written.
+uint64_t output_format_frame(char *dest, const int *values, const uint64_t *sequences, const int *statuses, uint64_t count) {
+	struct output_frame_t frame;
+	struct output_record_t record;
+	frame.length = htole32(count * sizeof(struct output_record_t));
+	frame.count = htole32(count);
+	memcpy(dest, &frame, sizeof(frame));
+	dest += sizeof(frame);
+	for(uint64_t i = 0; i < count; ++i) {
+		record.sequence = htole64(sequences[i]);
+		record.value = htole32(values[i]);
+		record.status = htole32(statuses[i]);
+		memcpy(dest, &record, sizeof(record));
+		dest += sizeof(record);
+	}
+	return OUTPUT_FRAME_SIZE(count);
+}
+
+//Returns how many decimal digits a number has. The bit length gives an estimate that is at most one short, which one comparison settles.
+//Setting the lowest bit makes zero count as one digit, and never moves a number past a power of ten.
+int output_digits(uint32_t value) {
+	static const uint32_t powers[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+	value |= 1;
+	int estimate = ((32 - __builtin_clz(value)) * 1233) >> 12;
+	return estimate + (value >= powers[estimate]);
+}
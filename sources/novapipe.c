@@ -6,31 +6,182 @@ Purpose: Provide functions to manipulate the modules and elements of the Nova ap
 */
 
 //Necessary imports.
+#define _GNU_SOURCE
 #include"novapipe.h"
+#include<string.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+
+//Adds to a telemetry counter. Each counter has a single writer, so a plain load and store is enough.
+#define BUFFER_STAT_ADD(counter, n) atomic_store_explicit(&(counter), atomic_load_explicit(&(counter), memory_order_relaxed) + (n), memory_order_relaxed)
+
+//Registry of buffers that can be looked up by name.
+struct buffer_t *buffer_registry[BUFFER_REGISTRY_SIZE];
+pthread_mutex_t buffer_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//Private functions.
+struct buffer_t *buffer_alloc(uint64_t, char, char);
+void buffer_init(struct buffer_t *, void *, uint64_t, char);
+void buffer_ring_init(struct buffer_ring_t *, uint64_t, char);
+void *buffer_map_mirror(uint64_t);
+char buffer_map_twice(int, uint64_t, uint64_t, void *);
+void buffer_spsc_write_lock(struct buffer_t *, uint64_t);
+void buffer_spsc_write_unlock(struct buffer_t *, uint64_t);
+void buffer_spsc_read_lock(struct buffer_t *, uint64_t);
+void buffer_spsc_read_unlock(struct buffer_t *, uint64_t);
+char buffer_can_write(void *);
+char buffer_can_read(void *);
+char buffer_spsc_can_write(void *);
+char buffer_spsc_can_read(void *);
+uint64_t buffer_spsc_writable(struct buffer_t *);
+uint64_t buffer_spsc_readable(struct buffer_t *);
+void buffer_spsc_switch(struct buffer_t *);
+void buffer_spsc_adopt(struct buffer_t *);
+void buffer_free_memory(struct buffer_t *, void *, uint64_t);
+void buffer_stat_init(struct buffer_stat_t *, uint64_t);
+void buffer_stat_sample(struct buffer_stat_t *, uint64_t, uint64_t);
+
+//Arguments for the checks run while waiting on a lock-free buffer.
+struct buffer_need_t {
+	struct buffer_t *buf;
+	uint64_t need;
+};
 
 //Create pipeline buffer.
 struct buffer_t *buffer_create(uint64_t size) {
+	return buffer_alloc(size, BUFFER_MODE_LOCKED, 0);
+}
+
+//Create a lock-free pipeline buffer. Only one thread may write to it and only one thread may read from it.
+struct buffer_t *buffer_create_spsc(uint64_t size) {
+	return buffer_alloc(size, BUFFER_MODE_SPSC, 0);
+}
+
+//Create a lock-free pipeline buffer whose memory is mapped twice back to back. The size is rounded up to a whole number of pages.
+//Falls back to a plain lock-free buffer if the mapping cannot be made.
+struct buffer_t *buffer_create_mirror(uint64_t size) {
+	uint64_t page = sysconf(_SC_PAGESIZE);
+	struct buffer_t *ret_val = buffer_alloc((size + page - 1) / page * page, BUFFER_MODE_SPSC, 1);
+	if(ret_val == NULL) ret_val = buffer_alloc(size, BUFFER_MODE_SPSC, 0);
+	return ret_val;
+}
+
+//Create a lock-free buffer over a read-only mapping of a file. The buffer starts out full and closed, so it has a reader and no writer.
+//The mapping is read in order, and the kernel is told so. An empty file gives an empty buffer. Returns NULL if the file cannot be mapped.
+struct buffer_t *buffer_create_file(const char *path) {
+	struct buffer_t *ret_val = NULL;
+	struct stat file_stat;
+	int fd = path != NULL ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+	if(fd != -1) {
+		if(fstat(fd, &file_stat) == -1) file_stat.st_size = -1;
+		if(file_stat.st_size == 0) ret_val = buffer_alloc(1, BUFFER_MODE_SPSC, 0);
+		else if(file_stat.st_size > 0) {
+			void *memory = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(memory != MAP_FAILED) {
+				madvise(memory, file_stat.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+				ret_val = aligned_alloc(BUFFER_CACHE_LINE, sizeof(struct buffer_t));
+				if(ret_val != NULL) {
+					buffer_init(ret_val, memory, file_stat.st_size, BUFFER_MODE_SPSC);
+					ret_val->mapped = 1;
+					atomic_init(&ret_val->ring->pos_write, file_stat.st_size);
+				} else munmap(memory, file_stat.st_size);
+			}
+		}
+
+		//The mapping keeps the file alive.
+		close(fd);
+		if(ret_val != NULL) atomic_init(&ret_val->ring->closed, 1);
+	}
+	return ret_val;
+}
+
+//Create a lock-free buffer over memory that belongs to someone else, such as part of a mapped script. Like a file buffer, it starts out full and closed.
+//The memory must outlive the buffer, which never frees it. Returns NULL if the buffer cannot be had.
+struct buffer_t *buffer_create_view(void *memory, uint64_t size) {
+	struct buffer_t *ret_val = NULL;
+	if(size == 0) ret_val = buffer_alloc(1, BUFFER_MODE_SPSC, 0);
+	else if(memory != NULL) {
+		ret_val = aligned_alloc(BUFFER_CACHE_LINE, sizeof(struct buffer_t));
+		if(ret_val != NULL) {
+			buffer_init(ret_val, memory, size, BUFFER_MODE_SPSC);
+			ret_val->borrowed = 1;
+			atomic_init(&ret_val->ring->pos_write, size);
+		}
+	}
+	if(ret_val != NULL) atomic_init(&ret_val->ring->closed, 1);
+	return ret_val;
+}
+
+//Create, or attach to, a lock-free buffer in named POSIX shared memory, so that its writer and its reader may be in different processes.
+//The shared region holds the control block of the ring on its first page and the ring after it. The ring is mapped twice like a mirrored buffer, and waits on it use futexes that work across processes.
+//The creating side sizes the ring, rounded up to whole pages, and replaces any ring left under the name. An attaching side takes the size from the region and ignores its own.
+//Returns NULL if the memory cannot be had, or if an attaching side finds no ring set up under the name yet. The creator removes the name when it destroys the buffer.
+struct buffer_t *buffer_create_shared(const char *name, uint64_t size, char create) {
+	struct buffer_t *ret_val = NULL;
+	uint64_t page = sysconf(_SC_PAGESIZE);
+	struct stat file_stat;
+	int fd = -1;
+	if(name != NULL && strlen(name) < BUFFER_NAME_SIZE && size > 0) {
+		if(create) {
+			size = (size + page - 1) / page * page;
+			shm_unlink(name);
+			fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+			if(fd != -1 && ftruncate(fd, page + size) != 0) {
+				close(fd);
+				fd = -1;
+			}
+		} else {
+			fd = shm_open(name, O_RDWR | O_CLOEXEC, 0);
+			if(fd != -1 && (fstat(fd, &file_stat) != 0 || (uint64_t)file_stat.st_size <= page)) {
+				close(fd);
+				fd = -1;
+			} else if(fd != -1) size = file_stat.st_size - page;
+		}
+	}
+	if(fd != -1) {
+
+		//Reserve the address space for the control block and both views of the ring, then map the file over it.
+		void *base = mmap(NULL, page + size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(base != MAP_FAILED) {
+			struct buffer_ring_t *ring = base;
+			if(mmap(base, page, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED && buffer_map_twice(fd, page, size, base + page)) {
+				if(create) buffer_ring_init(ring, size, 1);
+
+				//The magic is stored last by the creator, so an attaching side that sees it sees the whole control block.
+				if(atomic_load_explicit(&ring->magic, memory_order_acquire) == BUFFER_RING_MAGIC && ring->size == size) ret_val = aligned_alloc(BUFFER_CACHE_LINE, sizeof(struct buffer_t));
+			}
+			if(ret_val != NULL) {
+				buffer_init(ret_val, base + page, size, BUFFER_MODE_SPSC);
+				ret_val->ring = ring;
+				ret_val->mirror = 1;
+				ret_val->shared = 1;
+				if(create) strcpy(ret_val->shared_name, name);
+			} else munmap(base, page + size * 2);
+		}
+
+		//The mappings keep the shared memory alive.
+		close(fd);
+		if(ret_val == NULL && create) shm_unlink(name);
+	}
+	return ret_val;
+}
+
+//Allocate and initialize a buffer in the given mode, optionally mirrored.
+struct buffer_t *buffer_alloc(uint64_t size, char mode, char mirror) {
 	
-	//Variable to return at the end. Attempt allocation.
-	struct buffer_t *ret_val = malloc(sizeof(struct buffer_t));
+	//Variable to return at the end. Attempt allocation. The struct is cache line aligned so the writer and reader sides do not share a line.
+	struct buffer_t *ret_val = aligned_alloc(BUFFER_CACHE_LINE, sizeof(struct buffer_t));
 
 	//If allocation is successful. allocate the buffer inside the wrapper.
 	if(ret_val != NULL) {
-		ret_val->memory = malloc(size);
+		void *memory = mirror ? buffer_map_mirror(size) : malloc(size);
 
 		//If allocation is successful. Initialize
-		if(ret_val->memory != NULL) {
-			pthread_mutex_init(&(ret_val->lock), NULL);
-			pthread_cond_init(&(ret_val->cond_write), NULL);
-			pthread_cond_init(&(ret_val->cond_read), NULL);
-			ret_val->size = size;
-			ret_val->end = ret_val->memory + size;
-			ret_val->cursor_read = ret_val->memory;
-			ret_val->cursor_write = ret_val->memory;
-			ret_val->num_sleeping_writers = 0;
-			ret_val->num_sleeping_readers = 0;
-			ret_val->wait = 0;
-			ret_val->state = -1;
+		if(memory != NULL) {
+			buffer_init(ret_val, memory, size, mode);
+			ret_val->mirror = mirror;
 
 		//Otherwise free struct and null it.
 		} else {
@@ -43,6 +194,95 @@ struct buffer_t *buffer_create(uint64_t size) {
 	return ret_val;
 }
 
+//Initialize a buffer over the given memory, as an empty plain buffer with its own shared part.
+void buffer_init(struct buffer_t *buf, void *memory, uint64_t size, char mode) {
+	buf->ring = &buf->ring_local;
+	buffer_ring_init(buf->ring, size, 0);
+	pthread_mutex_init(&(buf->lock), NULL);
+	pthread_cond_init(&(buf->cond_write), NULL);
+	pthread_cond_init(&(buf->cond_read), NULL);
+	buf->memory = memory;
+	buf->size = size;
+	buf->end = memory + size;
+	buf->cursor_read = memory;
+	buf->cursor_write = memory;
+	buf->memory_read = memory;
+	buf->end_read = buf->end;
+	buf->size_read = size;
+	atomic_init(&buf->resize, 0);
+	atomic_init(&buf->switch_pending, 0);
+	buf->pos_switch = 0;
+	buf->num_sleeping_writers = 0;
+	buf->num_sleeping_readers = 0;
+	buf->wait = 0;
+	buf->state = -1;
+	buf->mode = mode;
+	buf->mirror = 0;
+	buf->mapped = 0;
+	buf->borrowed = 0;
+	buf->shared = 0;
+	buf->shared_name[0] = '\0';
+	buf->cache_read = 0;
+	buf->cache_write = 0;
+	buffer_stat_init(&buf->stat_write, size);
+	buffer_stat_init(&buf->stat_read, size);
+	buf->name[0] = '\0';
+}
+
+//Initialize the shared part of an empty buffer of the given size, optionally for use across processes.
+void buffer_ring_init(struct buffer_ring_t *ring, uint64_t size, char shared) {
+	ring->size = size;
+	atomic_init(&ring->closed, 0);
+	atomic_init(&ring->pos_write, 0);
+	atomic_init(&ring->pos_read, 0);
+	if(shared) {
+		wait_init_shared(&ring->wait_write);
+		wait_init_shared(&ring->wait_read);
+	} else {
+		wait_init(&ring->wait_write);
+		wait_init(&ring->wait_read);
+	}
+	atomic_store_explicit(&ring->magic, BUFFER_RING_MAGIC, memory_order_release);
+}
+
+//Maps size bytes of a file from the given offset twice in a row, over address space already reserved at the given address. Returns 1 on success.
+char buffer_map_twice(int fd, uint64_t offset, uint64_t size, void *at) {
+	return mmap(at, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, offset) != MAP_FAILED && mmap(at + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, offset) != MAP_FAILED;
+}
+
+//Maps a memory file of the given size twice in a row. Returns the start of the first mapping, or NULL on failure.
+void *buffer_map_mirror(uint64_t size) {
+	void *ret_val = NULL;
+	int fd = memfd_create("nova_buffer", MFD_CLOEXEC);
+	if(fd != -1) {
+		if(ftruncate(fd, size) == 0) {
+
+			//Reserve twice the address space first so that both halves are guaranteed to be adjacent, then map the file over each half.
+			ret_val = mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if(ret_val != MAP_FAILED) {
+				if(!buffer_map_twice(fd, 0, size, ret_val)) {
+					munmap(ret_val, size * 2);
+					ret_val = NULL;
+				}
+			} else ret_val = NULL;
+		}
+
+		//The mappings keep the memory file alive.
+		close(fd);
+	}
+	return ret_val;
+}
+
+//Frees the memory of a region of a buffer, however it was allocated.
+void buffer_free_memory(struct buffer_t *buf, void *memory, uint64_t size) {
+	if(memory != NULL && !buf->borrowed) {
+		if(buf->shared) munmap(buf->ring, sysconf(_SC_PAGESIZE) + size * 2);
+		else if(buf->mirror) munmap(memory, size * 2);
+		else if(buf->mapped) munmap(memory, size);
+		else free(memory);
+	}
+}
+
 //Deallocate buffer.
 void buffer_destroy(struct buffer_t **buf) {
 
@@ -50,10 +290,13 @@ void buffer_destroy(struct buffer_t **buf) {
 	if(buf != NULL) {
 		if(*buf != NULL) {
 
-			//If buffer inside wrapper isn't null, free it.
-			if((*buf)->memory != NULL) {
-				free((*buf)->memory);
-			}
+			//Take the buffer out of the registry.
+			buffer_unregister(*buf);
+
+			//Free the memory inside the wrapper, and the old region too if the reader never moved off it after a resize.
+			if((*buf)->memory_read != (*buf)->memory) buffer_free_memory(*buf, (*buf)->memory_read, (*buf)->size_read);
+			buffer_free_memory(*buf, (*buf)->memory, (*buf)->size);
+			if((*buf)->shared_name[0] != '\0') shm_unlink((*buf)->shared_name);
 
 			//Free the pthread library structures.
 			pthread_mutex_destroy(&((*buf)->lock));
@@ -68,6 +311,14 @@ void buffer_destroy(struct buffer_t **buf) {
 
 //Locks lock for writer. Does control logic.
 void buffer_write_lock(struct buffer_t *buf) {
+	if(buf->mode == BUFFER_MODE_SPSC) {
+		buffer_spsc_write_lock(buf, 1);
+		return;
+	}
+
+	//If the buffer is full, spin and then yield for a while before going for the lock and sleeping.
+	char spun = buf->state != 1 || wait_spin(&buf->ring->wait_write, buffer_can_write, buf);
+
 	//Obtain buffer lock.
 	pthread_mutex_lock(&(buf->lock));
 
@@ -78,7 +329,9 @@ void buffer_write_lock(struct buffer_t *buf) {
 			pthread_cond_wait(&buf->cond_write, &buf->lock);
 		}
 		--buf->num_sleeping_writers;
+		if(!spun) wait_count(&buf->ring->wait_write, WAIT_PHASE_PARK);
 	}
+	BUFFER_STAT_ADD(buf->stat_write.locks, 1);
 
 	//Check if input has been instructed to wait for output to obtain the lock, and if so wait until signaled by output that the lock has been obtained.
 	//This is used to ensure that each wake is successful.
@@ -87,11 +340,16 @@ void buffer_write_lock(struct buffer_t *buf) {
 	if(buf->wait == -1) {
 		buf->wait = 0;
 		pthread_cond_signal(&buf->cond_read);
+		BUFFER_STAT_ADD(buf->stat_write.handshakes, 1);
 	}
 }
 
 //Unlocks lock for writer. Does control logic.
 void buffer_write_unlock(struct buffer_t *buf, uint64_t diff) {
+	if(buf->mode == BUFFER_MODE_SPSC) {
+		buffer_spsc_write_unlock(buf, diff);
+		return;
+	}
 
 	//Reset the cursor to the start if the end has been reached.
 	if(buf->cursor_write >= buf->end) buf->cursor_write = buf->memory;
@@ -100,11 +358,16 @@ void buffer_write_unlock(struct buffer_t *buf, uint64_t diff) {
 	//Otherwise, the buffer state is to be a 0, or normal.
 	else buf->state = 0;	
 
+	//Record the bytes and sample how full the buffer is.
+	BUFFER_STAT_ADD(buf->stat_write.bytes, diff);
+	buffer_stat_sample(&buf->stat_write, buf->state == 1 ? buf->size : (buf->cursor_write - buf->cursor_read + buf->size) % buf->size, buf->size);
+
 	//Check if writing was done and if there are any readers that are sleeping due to an empty buffer.
 	//If so set wait flag to 1, to force input to wait on output, and signal output to wake.
 	if(diff > 0 && buf->num_sleeping_readers > 0) {
 		buf->wait = 1;
 		pthread_cond_signal(&(buf->cond_read));
+		BUFFER_STAT_ADD(buf->stat_write.wakes, 1);
 	}
 	
 	//Unlock the buffer.
@@ -113,16 +376,25 @@ void buffer_write_unlock(struct buffer_t *buf, uint64_t diff) {
 
 //Locks lock for reader. Does control logic.
 void buffer_read_lock(struct buffer_t *buf) {
+	if(buf->mode == BUFFER_MODE_SPSC) {
+		buffer_spsc_read_lock(buf, 1);
+		return;
+	}
+
+	//If the buffer is empty, spin and then yield for a while before going for the lock and sleeping.
+	char spun = buf->state != -1 || wait_spin(&buf->ring->wait_read, buffer_can_read, buf);
 
 	//Obtain the buffer lock.
 	pthread_mutex_lock(&(buf->lock));
 	
 	//Check if buffer state is empty. If so wait until input signals that there is output to read.
-	if(buf->state == -1) {
+	if(buf->state == -1 && !buf->ring->closed) {
 		++buf->num_sleeping_readers;
-		while(buf->state == -1) pthread_cond_wait(&buf->cond_read, &buf->lock);
+		while(buf->state == -1 && !buf->ring->closed) pthread_cond_wait(&buf->cond_read, &buf->lock);
 		--buf->num_sleeping_readers;
+		if(!spun) wait_count(&buf->ring->wait_read, WAIT_PHASE_PARK);
 	}
+	BUFFER_STAT_ADD(buf->stat_read.locks, 1);
 	
 	//Check if the wait flag indicates that output needs to wait for input to start, and wait if necessary.
 	//This prevents output from locking input out after signaling input to wake back up.
@@ -132,11 +404,16 @@ void buffer_read_lock(struct buffer_t *buf) {
 	if(buf->wait == 1) {
 		buf->wait = 0;
 		pthread_cond_signal(&buf->cond_write);
+		BUFFER_STAT_ADD(buf->stat_read.handshakes, 1);
 	}
 }
 
 //Unlocks lock for reader. Does control logic.
 void buffer_read_unlock(struct buffer_t *buf, uint64_t diff) {
+	if(buf->mode == BUFFER_MODE_SPSC) {
+		buffer_spsc_read_unlock(buf, diff);
+		return;
+	}
 
 	//Check if the read cursor has reached the end and if so reset it to the start.
 	if(buf->cursor_read >= buf->end) buf->cursor_read = buf->memory;
@@ -145,206 +422,570 @@ void buffer_read_unlock(struct buffer_t *buf, uint64_t diff) {
 	//Otherwise, set buffer state to 0, or normal.
 	else buf->state = 0;	
 
+	//Record the bytes and sample how full the buffer is.
+	BUFFER_STAT_ADD(buf->stat_read.bytes, diff);
+	buffer_stat_sample(&buf->stat_read, buf->state == -1 ? 0 : (buf->cursor_write - buf->cursor_read + buf->size) % buf->size, buf->size);
+
 	//Check if anything was read and if there are sleeping writers waiting for free space to write to in the buffer.
 	//If so, set the wait flag to -1 to force output to wait for input to wake, and wake input.
 	if(diff > 0 && buf->num_sleeping_writers > 0) {
 		buf->wait = -1;
 		pthread_cond_signal(&(buf->cond_write));
+		BUFFER_STAT_ADD(buf->stat_read.wakes, 1);
 	}
 
 	//Unlock the buffer.
 	pthread_mutex_unlock(&(buf->lock));
 }
 
-//Methods that create and destroy context stacks.
-struct context_queue_t *context_queue_create() {
-	struct context_queue_t *ret_val = malloc(sizeof(struct context_queue_t));
-	if(ret_val != NULL) {
-		pthread_mutex_init(&ret_val->lock, NULL);
-		ret_val->start = NULL;
-		ret_val->end = NULL;
+//Returns how many bytes the writer may write contiguously at the write cursor. Only valid between buffer_write_lock and buffer_write_unlock.
+uint64_t buffer_write_span(struct buffer_t *buf) {
+	uint64_t ret_val = 0;
+	if(buf->mode == BUFFER_MODE_SPSC) {
+		ret_val = buffer_spsc_writable(buf);
+		if(!buf->mirror && ret_val > (uint64_t)(buf->end - buf->cursor_write)) ret_val = buf->end - buf->cursor_write;
+
+	//If read is ahead of write, write until read. If read is behind write, write until end.
+	} else if(buf->cursor_write < buf->cursor_read) ret_val = buf->cursor_read - buf->cursor_write;
+	else ret_val = buf->end - buf->cursor_write;
+	return ret_val;
+}
+
+//Returns how many bytes the reader may read contiguously at the read cursor. Only valid between buffer_read_lock and buffer_read_unlock.
+uint64_t buffer_read_span(struct buffer_t *buf) {
+	uint64_t ret_val = 0;
+	if(buf->mode == BUFFER_MODE_SPSC) {
+		ret_val = buffer_spsc_readable(buf);
+		if(!buf->mirror && ret_val > (uint64_t)(buf->end_read - buf->cursor_read)) ret_val = buf->end_read - buf->cursor_read;
+
+	//If the buffer is empty, which it only is here once closed, there is nothing to read.
+	//If write is ahead of read, read until write. Otherwise read until end.
+	} else if(buf->state == -1) ret_val = 0;
+	else if(buf->cursor_write > buf->cursor_read) ret_val = buf->cursor_write - buf->cursor_read;
+	else ret_val = buf->end - buf->cursor_read;
+	return ret_val;
+}
+
+//Span API. Waits until at least n bytes can be written and returns the write cursor. Must be paired with buffer_commit.
+//On a mirrored buffer the n bytes are always contiguous. On other buffers the span may stop early at the end, and locked buffers only wait for any space. buffer_write_span gives the exact length.
+void *buffer_reserve(struct buffer_t *buf, uint64_t n) {
+	if(n > buf->size) n = buf->size;
+	if(n == 0) n = 1;
+	if(buf->mode == BUFFER_MODE_SPSC) buffer_spsc_write_lock(buf, n);
+	else buffer_write_lock(buf);
+	return buf->cursor_write;
+}
+
+//Span API. Publishes n bytes written at the span returned by buffer_reserve.
+void buffer_commit(struct buffer_t *buf, uint64_t n) {
+	buf->cursor_write += n;
+	buffer_write_unlock(buf, n);
+}
+
+//Span API. Waits until at least n bytes can be read and returns the read cursor. Must be paired with buffer_consume.
+//The same contiguity rules as buffer_reserve apply. buffer_read_span gives the exact length.
+//A closed buffer does not wait, so the span may be shorter than n, or empty once the buffer is drained.
+void *buffer_peek(struct buffer_t *buf, uint64_t n) {
+	if(n > buf->size_read) n = buf->size_read;
+	if(n == 0) n = 1;
+	if(buf->mode == BUFFER_MODE_SPSC) buffer_spsc_read_lock(buf, n);
+	else buffer_read_lock(buf);
+	return buf->cursor_read;
+}
+
+//Span API. Releases n bytes read from the span returned by buffer_peek.
+void buffer_consume(struct buffer_t *buf, uint64_t n) {
+	buf->cursor_read += n;
+	buffer_read_unlock(buf, n);
+}
+
+//Span API. Like buffer_reserve, but never waits. Returns the write cursor if at least n bytes can be written, and NULL otherwise, in which case there is nothing to commit.
+//The cached read position is refreshed whenever it shows too little room, so a writer that needs more than one byte does not give up on a stale view.
+//For stages that are stepped by a shared worker rather than run by a thread of their own. Lock-free buffers only.
+void *buffer_try_reserve(struct buffer_t *buf, uint64_t n) {
+	void *ret_val = NULL;
+	if(n > buf->size) n = buf->size;
+	if(n == 0) n = 1;
+	if(buf->mode == BUFFER_MODE_SPSC) {
+		struct buffer_need_t arg = {buf, n};
+		if(atomic_load_explicit(&buf->resize, memory_order_relaxed) != 0) buffer_spsc_switch(buf);
+		if(buffer_spsc_writable(buf) < n) buffer_spsc_can_write(&arg);
+		if(buffer_spsc_writable(buf) >= n) ret_val = buf->cursor_write;
 	}
 	return ret_val;
 }
-void context_queue_destroy(struct context_queue_t **queue) {
-	if(queue != NULL) {
-		if(*queue != NULL) {
-			do {
-				context_remove(*queue);
-			} while((*queue)->end != NULL);
-			pthread_mutex_destroy(&(*queue)->lock);
-			free(*queue);
+
+//Span API. Like buffer_peek for one byte, but never waits. Returns the read cursor if there is anything to read, and NULL otherwise, in which case there is nothing to consume.
+//A NULL return on a closed buffer means that it is drained. Lock-free buffers only.
+void *buffer_try_peek(struct buffer_t *buf) {
+	void *ret_val = NULL;
+	if(buf->mode == BUFFER_MODE_SPSC) {
+		struct buffer_need_t arg = {buf, 1};
+		if(buffer_spsc_readable(buf) == 0) buffer_spsc_can_read(&arg);
+		if(buffer_spsc_readable(buf) > 0) ret_val = buf->cursor_read;
+	}
+	return ret_val;
+}
+
+//Span API. Like buffer_peek, but gives up after the given number of nanoseconds, so the span may be shorter than n. For readers that gather data before acting on it.
+//Lock-free buffers only.
+void *buffer_peek_timed(struct buffer_t *buf, uint64_t n, uint64_t ns) {
+	if(buf->mode == BUFFER_MODE_SPSC) {
+		struct buffer_need_t arg = {buf, n > buf->size_read ? buf->size_read : n};
+		if(buffer_spsc_readable(buf) < arg.need && !buffer_spsc_can_read(&arg)) wait_for_timed(&buf->ring->wait_read, buffer_spsc_can_read, &arg, ns);
+	}
+	return buf->cursor_read;
+}
+
+//Span API. Fills in up to two vectors covering all that can be read, for a reader that passes them to writev. Returns how many were filled in.
+//A span that wraps around the end of a plain lock-free buffer takes two. Only valid between buffer_peek and buffer_consume.
+int buffer_read_vec(struct buffer_t *buf, struct iovec *iov) {
+	int ret_val = 0;
+	uint64_t span = buffer_read_span(buf);
+	if(span > 0) {
+		iov[0].iov_base = buf->cursor_read;
+		iov[0].iov_len = span;
+		ret_val = 1;
+		if(buf->mode == BUFFER_MODE_SPSC && buffer_spsc_readable(buf) > span) {
+			iov[1].iov_base = buf->memory_read;
+			iov[1].iov_len = buffer_spsc_readable(buf) - span;
+			ret_val = 2;
 		}
 	}
+	return ret_val;
 }
 
-//Functions that create and destroy context elements.
-struct context_element_t *context_element_create() {
-	struct context_element_t *ret_val = malloc(sizeof(struct context_element_t));
-	if(ret_val != NULL) {
-		ret_val->next = NULL;
-		ret_val->back = NULL;
-		ret_val->start = 0;
-		ret_val->size = 0;
-		ret_val->read = 0;
-		ret_val->type = 0;
-		ret_val->complete = 0;
+//Writes n bytes to the buffer, waiting for room as needed. The bytes may be split over several spans.
+void buffer_put(struct buffer_t *buf, const void *data, uint64_t n) {
+	while(n > 0) {
+		buffer_reserve(buf, n);
+		uint64_t span = buffer_write_span(buf);
+		if(span > n) span = n;
+		memcpy(buf->cursor_write, data, span);
+		buffer_commit(buf, span);
+		data += span;
+		n -= span;
+	}
+}
+
+//Marks the end of the data, from the writer. Nothing may be written afterward. A reader waiting for data wakes, and finds the buffer drained once it has read the rest.
+void buffer_close(struct buffer_t *buf) {
+	if(buf != NULL) {
+		if(buf->mode == BUFFER_MODE_SPSC) {
+			atomic_store_explicit(&buf->ring->closed, 1, memory_order_release);
+			wait_wake(&buf->ring->wait_read);
+		} else {
+			pthread_mutex_lock(&buf->lock);
+			buf->ring->closed = 1;
+			pthread_cond_broadcast(&buf->cond_read);
+			pthread_mutex_unlock(&buf->lock);
+		}
+	}
+}
+
+//Checks, from the reader, whether the buffer has been closed and everything in it read. Locked buffers must be checked between buffer_peek and buffer_consume.
+char buffer_drained(struct buffer_t *buf) {
+	char ret_val = 0;
+	if(buf != NULL) {
+		if(buf->mode == BUFFER_MODE_SPSC) {
+
+			//The flag is read first. The writer sets it after publishing its last bytes, so the refreshed position is final.
+			if(atomic_load_explicit(&buf->ring->closed, memory_order_acquire)) {
+				buf->cache_write = atomic_load_explicit(&buf->ring->pos_write, memory_order_acquire);
+				ret_val = buffer_spsc_readable(buf) == 0;
+			}
+		} else ret_val = buf->ring->closed && buf->state == -1;
 	}
 	return ret_val;
 }
-void context_element_destroy(struct context_element_t **element) {
-	if(element != NULL) {
-		if(*element != NULL) {
-			free(*element);
+
+//Lock-free writer entry. Waits until at least need bytes are free, following the buffer's waiting policy.
+void buffer_spsc_write_lock(struct buffer_t *buf, uint64_t need) {
+	struct buffer_need_t arg = {buf, need};
+	BUFFER_STAT_ADD(buf->stat_write.locks, 1);
+
+	//Move to a new region first if the buffer has been asked to resize.
+	//A writer never waits for more than the whole buffer, and a switch may leave it in a smaller region than the one the need was held to, so it is held again after every switch.
+	if(atomic_load_explicit(&buf->resize, memory_order_relaxed) != 0) buffer_spsc_switch(buf);
+	if(arg.need > buf->size) arg.need = buf->size;
+
+	//Refresh the cached read position only when the cached view says there is not enough space.
+	//A resize requested while waiting also ends the wait, since the new region may have the space.
+	while(buffer_spsc_writable(buf) < arg.need && !buffer_spsc_can_write(&arg)) {
+		wait_for(&buf->ring->wait_write, buffer_spsc_can_write, &arg);
+		if(atomic_load_explicit(&buf->resize, memory_order_relaxed) != 0) buffer_spsc_switch(buf);
+		if(arg.need > buf->size) arg.need = buf->size;
+	}
+}
+
+//Lock-free writer exit. Publishes the written bytes and wakes the reader if it is parked.
+void buffer_spsc_write_unlock(struct buffer_t *buf, uint64_t diff) {
+	if(diff > 0) {
+
+		//Move the cursor back by a whole buffer if the end has been reached. In a mirrored buffer it may have gone past the end into the second mapping.
+		if(buf->cursor_write >= buf->end) buf->cursor_write -= buf->size;
+
+		//Publish the bytes. The release pairs with the acquire in the reader so it sees the data.
+		uint64_t pos = atomic_load_explicit(&buf->ring->pos_write, memory_order_relaxed) + diff;
+		atomic_store_explicit(&buf->ring->pos_write, pos, memory_order_release);
+		if(wait_wake(&buf->ring->wait_read)) BUFFER_STAT_ADD(buf->stat_write.wakes, 1);
+
+		//Record the bytes and sample how full the buffer is, as far as the writer knows.
+		BUFFER_STAT_ADD(buf->stat_write.bytes, diff);
+		buffer_stat_sample(&buf->stat_write, buf->size - buffer_spsc_writable(buf), buf->size);
+	}
+}
+
+//Lock-free reader entry. Waits until at least need bytes are readable, following the buffer's waiting policy.
+void buffer_spsc_read_lock(struct buffer_t *buf, uint64_t need) {
+	struct buffer_need_t arg = {buf, need};
+	BUFFER_STAT_ADD(buf->stat_read.locks, 1);
+
+	//Refresh the cached write position only when the cached view says there is not enough to read.
+	if(buffer_spsc_readable(buf) < need) {
+		if(!buffer_spsc_can_read(&arg)) wait_for(&buf->ring->wait_read, buffer_spsc_can_read, &arg);
+	}
+}
+
+//Lock-free reader exit. Releases the read bytes back to the writer and wakes it if it is parked.
+void buffer_spsc_read_unlock(struct buffer_t *buf, uint64_t diff) {
+	if(diff > 0) {
+
+		//Check if the read cursor has reached the end and if so move it back by a whole buffer.
+		if(buf->cursor_read >= buf->end_read) buf->cursor_read -= buf->size_read;
+
+		//Record the bytes and sample how full the buffer is, as far as the reader knows.
+		//This is done before the release, as after it the writer is free to resize the region.
+		uint64_t pos = atomic_load_explicit(&buf->ring->pos_read, memory_order_relaxed) + diff;
+		BUFFER_STAT_ADD(buf->stat_read.bytes, diff);
+		buffer_stat_sample(&buf->stat_read, buf->cache_write > pos ? buf->cache_write - pos : 0, buf->size_read);
+
+		//Release the bytes. The release pairs with the acquire in the writer so it does not overwrite bytes still being read.
+		atomic_store_explicit(&buf->ring->pos_read, pos, memory_order_release);
+		if(wait_wake(&buf->ring->wait_write)) BUFFER_STAT_ADD(buf->stat_read.wakes, 1);
+	}
+}
+
+//Checks used while waiting on a locked buffer, outside of the lock.
+char buffer_can_write(void *buf) {
+	return ((struct buffer_t *)buf)->state != 1;
+}
+char buffer_can_read(void *buf) {
+	return ((struct buffer_t *)buf)->state != -1 || ((struct buffer_t *)buf)->ring->closed;
+}
+
+//Checks used while waiting on a lock-free buffer. Each refreshes the cached copy of the other side's position.
+char buffer_spsc_can_write(void *arg) {
+	struct buffer_t *buf = ((struct buffer_need_t *)arg)->buf;
+	buf->cache_read = atomic_load_explicit(&buf->ring->pos_read, memory_order_acquire);
+	if(buffer_spsc_writable(buf) >= ((struct buffer_need_t *)arg)->need) return 1;
+	return atomic_load_explicit(&buf->resize, memory_order_relaxed) != 0 && !atomic_load_explicit(&buf->switch_pending, memory_order_acquire);
+}
+char buffer_spsc_can_read(void *arg) {
+	struct buffer_t *buf = ((struct buffer_need_t *)arg)->buf;
+	buf->cache_write = atomic_load_explicit(&buf->ring->pos_write, memory_order_acquire);
+	return buffer_spsc_readable(buf) >= ((struct buffer_need_t *)arg)->need || atomic_load_explicit(&buf->ring->closed, memory_order_acquire);
+}
+
+//Returns how many bytes the writer has free in its region. Bytes still left in an old region do not count against the new one.
+uint64_t buffer_spsc_writable(struct buffer_t *buf) {
+	uint64_t start = buf->cache_read > buf->pos_switch ? buf->cache_read : buf->pos_switch;
+	return buf->size - (atomic_load_explicit(&buf->ring->pos_write, memory_order_relaxed) - start);
+}
+
+//Returns how many bytes the reader has to read in its region, moving it to the writer's new region once it has finished the old one.
+//The cached write position must be loaded before the switch flag is checked. The writer sets the flag before publishing any bytes in a new region, so any such bytes come with the flag.
+uint64_t buffer_spsc_readable(struct buffer_t *buf) {
+	uint64_t pos = atomic_load_explicit(&buf->ring->pos_read, memory_order_relaxed);
+	uint64_t limit = buf->cache_write;
+	if(atomic_load_explicit(&buf->switch_pending, memory_order_acquire)) {
+		if(pos == buf->pos_switch) buffer_spsc_adopt(buf);
+		else if(limit > buf->pos_switch) limit = buf->pos_switch;
+	}
+	return limit - pos;
+}
+
+//Writer side of a resize. Allocates a region of the requested size and writes into it from the current position on.
+//Only one switch may be in flight, so a request made while the reader is still on an older region waits for the next lock.
+void buffer_spsc_switch(struct buffer_t *buf) {
+	if(atomic_load_explicit(&buf->switch_pending, memory_order_acquire)) return;
+	uint64_t size = atomic_exchange_explicit(&buf->resize, 0, memory_order_relaxed);
+	if(buf->mirror) {
+		uint64_t page = sysconf(_SC_PAGESIZE);
+		size = (size + page - 1) / page * page;
+	}
+	if(size == 0 || size == buf->size) return;
+
+	//Give up on the resize if the memory cannot be had. The buffer carries on in its current region.
+	void *memory = buf->mirror ? buffer_map_mirror(size) : malloc(size);
+	if(memory == NULL) return;
+
+	//The reader only looks at the new region once it sees the flag, so the fields can be set before it.
+	buf->memory = memory;
+	buf->end = memory + size;
+	buf->size = size;
+	buf->cursor_write = memory;
+	atomic_store_explicit(&buf->stat_write.size, size, memory_order_relaxed);
+	buf->pos_switch = atomic_load_explicit(&buf->ring->pos_write, memory_order_relaxed);
+	atomic_store_explicit(&buf->switch_pending, 1, memory_order_release);
+}
+
+//Reader side of a resize. Frees the old region and moves onto the writer's. The writer does not touch its region fields until the flag is cleared.
+void buffer_spsc_adopt(struct buffer_t *buf) {
+	buffer_free_memory(buf, buf->memory_read, buf->size_read);
+	buf->memory_read = buf->memory;
+	buf->end_read = buf->end;
+	buf->size_read = buf->size;
+	buf->cursor_read = buf->memory;
+	atomic_store_explicit(&buf->stat_read.size, buf->size_read, memory_order_relaxed);
+	atomic_store_explicit(&buf->switch_pending, 0, memory_order_release);
+}
+
+//Checks whether a buffer can be resized. Only lock-free buffers in memory of their own can be.
+char buffer_resizable(struct buffer_t *buf) {
+	return buf != NULL && buf->mode == BUFFER_MODE_SPSC && !buf->mapped && !buf->borrowed && !buf->shared;
+}
+
+//Asks a lock-free buffer to change size. The writer moves to the new size at its next write, and nothing already in the buffer is lost.
+//Locked buffers cannot be resized. Returns 1 if the request was taken.
+char buffer_resize(struct buffer_t *buf, uint64_t size) {
+	char ret_val = 0;
+	if(buffer_resizable(buf) && size > 0) {
+		atomic_store_explicit(&buf->resize, size, memory_order_relaxed);
+
+		//Wake a writer waiting on a full buffer so it can move to the new region.
+		wait_wake(&buf->ring->wait_write);
+		ret_val = 1;
+	}
+	return ret_val;
+}
+
+//Initializes the telemetry of one side of a buffer.
+void buffer_stat_init(struct buffer_stat_t *stat, uint64_t size) {
+	atomic_init(&stat->size, size);
+	atomic_init(&stat->bytes, 0);
+	atomic_init(&stat->locks, 0);
+	atomic_init(&stat->wakes, 0);
+	atomic_init(&stat->handshakes, 0);
+	for(int i = 0; i < BUFFER_STAT_BUCKETS; ++i) atomic_init(&stat->occupancy[i], 0);
+}
+
+//Counts an occupancy sample of used out of size bytes into its histogram bucket. A full buffer goes in the last bucket.
+void buffer_stat_sample(struct buffer_stat_t *stat, uint64_t used, uint64_t size) {
+	uint64_t bucket = used * BUFFER_STAT_BUCKETS / size;
+	if(bucket >= BUFFER_STAT_BUCKETS) bucket = BUFFER_STAT_BUCKETS - 1;
+	BUFFER_STAT_ADD(stat->occupancy[bucket], 1);
+}
+
+//Registers a buffer under a name so that its telemetry can be looked up at runtime. Returns 1 on success.
+char buffer_register(struct buffer_t *buf, const char *name) {
+	char ret_val = 0;
+	if(buf != NULL && name != NULL) {
+		pthread_mutex_lock(&buffer_registry_lock);
+		for(int i = 0; i < BUFFER_REGISTRY_SIZE; ++i) {
+			if(buffer_registry[i] == NULL || buffer_registry[i] == buf) {
+				strncpy(buf->name, name, BUFFER_NAME_SIZE - 1);
+				buf->name[BUFFER_NAME_SIZE - 1] = '\0';
+				buffer_registry[i] = buf;
+				ret_val = 1;
+				break;
+			}
 		}
+		pthread_mutex_unlock(&buffer_registry_lock);
 	}
+	return ret_val;
 }
 
-/*
-void context_enqueue(struct context_queue_t *queue, struct context_element_t *element) {
-	if(queue != NULL && element != NULL) {
-		pthread_mutex_lock(&queue->lock);
-
-		element->next = queue->start;
-		if(queue->start != NULL) {
-			element->start = queue->start->start + queue->start->size;
-			queue->start->back = element;
-			queue->start->complete = 1;
+//Takes a buffer out of the registry, if it is in it.
+void buffer_unregister(struct buffer_t *buf) {
+	pthread_mutex_lock(&buffer_registry_lock);
+	for(int i = 0; i < BUFFER_REGISTRY_SIZE; ++i) {
+		if(buffer_registry[i] == buf) buffer_registry[i] = NULL;
+	}
+	pthread_mutex_unlock(&buffer_registry_lock);
+}
+
+//Looks up a registered buffer by name. Returns NULL if there is none.
+struct buffer_t *buffer_find(const char *name) {
+	struct buffer_t *ret_val = NULL;
+	if(name != NULL) {
+		pthread_mutex_lock(&buffer_registry_lock);
+		for(int i = 0; i < BUFFER_REGISTRY_SIZE && ret_val == NULL; ++i) {
+			if(buffer_registry[i] != NULL && strcmp(buffer_registry[i]->name, name) == 0) ret_val = buffer_registry[i];
 		}
-		queue->start = 1;
+		pthread_mutex_unlock(&buffer_registry_lock);
+	}
+	return ret_val;
+}
 
-		pthread_mutex_unlock(&queue->lock);
+//Takes a snapshot of the telemetry of a buffer. The counters keep moving while it is taken, so the snapshot is only approximately consistent.
+void buffer_stats(struct buffer_t *buf, struct buffer_stats_t *stats) {
+	if(buf != NULL && stats != NULL) {
+		stats->size = atomic_load_explicit(&buf->stat_write.size, memory_order_relaxed);
+		stats->bytes_written = atomic_load_explicit(&buf->stat_write.bytes, memory_order_relaxed);
+		stats->bytes_read = atomic_load_explicit(&buf->stat_read.bytes, memory_order_relaxed);
+		stats->write_locks = atomic_load_explicit(&buf->stat_write.locks, memory_order_relaxed);
+		stats->read_locks = atomic_load_explicit(&buf->stat_read.locks, memory_order_relaxed);
+		stats->writer_wakes = atomic_load_explicit(&buf->stat_write.wakes, memory_order_relaxed);
+		stats->reader_wakes = atomic_load_explicit(&buf->stat_read.wakes, memory_order_relaxed);
+		stats->handshakes = atomic_load_explicit(&buf->stat_write.handshakes, memory_order_relaxed) + atomic_load_explicit(&buf->stat_read.handshakes, memory_order_relaxed);
+		stats->writer_stalls = stats->reader_stalls = 0;
+		for(int i = 0; i < WAIT_NUM_PHASES; ++i) {
+			stats->writer_stalls += atomic_load_explicit(&buf->ring->wait_write.resolved[i], memory_order_relaxed);
+			stats->reader_stalls += atomic_load_explicit(&buf->ring->wait_read.resolved[i], memory_order_relaxed);
+		}
+		stats->writer_sleeps = atomic_load_explicit(&buf->ring->wait_write.resolved[WAIT_PHASE_PARK], memory_order_relaxed);
+		stats->reader_sleeps = atomic_load_explicit(&buf->ring->wait_read.resolved[WAIT_PHASE_PARK], memory_order_relaxed);
+		for(int i = 0; i < BUFFER_STAT_BUCKETS; ++i) stats->occupancy[i] = atomic_load_explicit(&buf->stat_write.occupancy[i], memory_order_relaxed) + atomic_load_explicit(&buf->stat_read.occupancy[i], memory_order_relaxed);
 	}
 }
 
-struct context_element_t *context_dequeue(struct context_queue_t *queue) {
+//Prints the telemetry of a buffer.
+void buffer_report(FILE *file, struct buffer_t *buf) {
+	if(file != NULL && buf != NULL) {
+		struct buffer_stats_t stats;
+		buffer_stats(buf, &stats);
+		fprintf(file, "%s (%lu bytes): written %lu, read %lu, write locks %lu, read locks %lu\n", buf->name[0] != '\0' ? buf->name : "buffer", (unsigned long)stats.size,
+			(unsigned long)stats.bytes_written, (unsigned long)stats.bytes_read, (unsigned long)stats.write_locks, (unsigned long)stats.read_locks);
+		fprintf(file, "\twriter stalls %lu (slept %lu), reader stalls %lu (slept %lu), wakes sent by writer %lu, by reader %lu, handshakes %lu\n",
+			(unsigned long)stats.writer_stalls, (unsigned long)stats.writer_sleeps, (unsigned long)stats.reader_stalls, (unsigned long)stats.reader_sleeps,
+			(unsigned long)stats.writer_wakes, (unsigned long)stats.reader_wakes, (unsigned long)stats.handshakes);
+		fprintf(file, "\toccupancy");
+		for(int i = 0; i < BUFFER_STAT_BUCKETS; ++i) fprintf(file, " %lu", (unsigned long)stats.occupancy[i]);
+		fprintf(file, "\n");
+		wait_report(file, "\twriter waits", &buf->ring->wait_write);
+		wait_report(file, "\treader waits", &buf->ring->wait_read);
+	}
+}
 
-}*/
+//Prints the telemetry of every registered buffer.
+void buffer_report_all(FILE *file) {
+	pthread_mutex_lock(&buffer_registry_lock);
+	for(int i = 0; i < BUFFER_REGISTRY_SIZE; ++i) {
+		if(buffer_registry[i] != NULL) buffer_report(file, buffer_registry[i]);
+	}
+	pthread_mutex_unlock(&buffer_registry_lock);
+}
 
-void context_append(struct context_queue_t *queue, uint64_t type) {
+//Methods that create and destroy context queues.
+struct context_queue_t *context_queue_create() {
+	struct context_queue_t *ret_val = aligned_alloc(BUFFER_CACHE_LINE, sizeof(struct context_queue_t));
+	if(ret_val != NULL) {
+		ret_val->ring = calloc(CONTEXT_QUEUE_SIZE, sizeof(struct context_element_t));
+		if(ret_val->ring != NULL) {
+			ret_val->mask = CONTEXT_QUEUE_SIZE - 1;
+			atomic_init(&ret_val->head, 0);
+			atomic_init(&ret_val->tail, 0);
+			ret_val->cache_tail = 0;
+		} else {
+			free(ret_val);
+			ret_val = NULL;
+		}
+	}
+	return ret_val;
+}
+void context_queue_destroy(struct context_queue_t **queue) {
 	if(queue != NULL) {
-		struct context_element_t *new_context_element = context_element_create();
-		if(new_context_element != NULL) {
-			new_context_element->size = 0;
-			pthread_mutex_lock(&queue->lock);
-			new_context_element->next = queue->start;
-			if(queue->start != NULL) {
-				new_context_element->start = queue->start->start + queue->start->size;
-				queue->start->back = new_context_element;
-				queue->start->type = type;
-				queue->start->complete = 1;
-			}
-			queue->start = new_context_element;
-			if(queue->end == NULL) queue->end = new_context_element;	
-			pthread_mutex_unlock(&queue->lock);
+		if(*queue != NULL) {
+			free((*queue)->ring);
+			free(*queue);
 		}
 	}
 }
+
+//Checks, from the parser, whether n more records can be appended without overtaking the interpreter.
+char context_reserve(struct context_queue_t *queue, uint64_t n) {
+	char ret_val = 0;
+	if(queue != NULL) {
+		uint64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+		//Only look at the interpreter's index when the cached copy says there is not enough room.
+		if(head + n - queue->cache_tail > queue->mask) queue->cache_tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+		ret_val = head + n - queue->cache_tail <= queue->mask;
+	}
+	return ret_val;
+}
+
+//Completes the open record with the given type and opens the next one. The caller must have checked for room with context_reserve.
+void context_append(struct context_queue_t *queue, uint64_t type) {
+	if(queue != NULL) {
+		uint64_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+		struct context_element_t *current = &queue->ring[head & queue->mask];
+		struct context_element_t *next = &queue->ring[(head + 1) & queue->mask];
+
+		//Recycle the next record in place.
+		current->type = type;
+		atomic_store_explicit(&next->size, 0, memory_order_relaxed);
+		next->start = current->start + atomic_load_explicit(&current->size, memory_order_relaxed);
+		next->read = 0;
+		next->type = 0;
+		next->failed = 0;
+
+		//Publish. The release pairs with the acquire in the interpreter so it sees the final size and type.
+		atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+	}
+}
 void context_increment(struct context_queue_t *queue, uint64_t sum) {
 	if(queue != NULL) {
-		pthread_mutex_lock(&queue->lock);
-		if(queue->start == NULL) {
-			queue->start = context_element_create();
-			if(queue->start != NULL) {
-				queue->end = queue->start;
-			} else {
-				pthread_mutex_unlock(&queue->lock);
-				return;
-			}
-		}
-		queue->start->size += sum;
-		pthread_mutex_unlock(&queue->lock);
+		struct context_element_t *current = &queue->ring[atomic_load_explicit(&queue->head, memory_order_relaxed) & queue->mask];
+		atomic_store_explicit(&current->size, atomic_load_explicit(&current->size, memory_order_relaxed) + sum, memory_order_relaxed);
 	}
 }
+
+//Marks the open record as holding a grammar error, from the parser. The mark is published with the record.
+void context_fail(struct context_queue_t *queue) {
+	if(queue != NULL) queue->ring[atomic_load_explicit(&queue->head, memory_order_relaxed) & queue->mask].failed = 1;
+}
+
+//Functions used by the interpreter on the oldest record.
+//Returns 1 once the oldest record is complete. Until then its type is not set and its size may still grow.
+char context_complete(struct context_queue_t *queue) {
+	return queue != NULL && atomic_load_explicit(&queue->tail, memory_order_relaxed) != atomic_load_explicit(&queue->head, memory_order_acquire);
+}
 void context_read_inc(struct context_queue_t *queue, uint64_t sum) {
-	if(queue != NULL) if(queue->end != NULL) queue->end->read += sum;
+	if(queue != NULL) queue->ring[atomic_load_explicit(&queue->tail, memory_order_relaxed) & queue->mask].read += sum;
 }
 uint64_t context_size(struct context_queue_t *queue) {
 	uint64_t ret_val = 0;
-	if(queue != NULL) if(queue->end != NULL) ret_val = queue->end->size;
+	if(queue != NULL) {
+		atomic_load_explicit(&queue->head, memory_order_acquire);
+		ret_val = atomic_load_explicit(&queue->ring[atomic_load_explicit(&queue->tail, memory_order_relaxed) & queue->mask].size, memory_order_relaxed);
+	}
 	return ret_val;
 }
 uint64_t context_read(struct context_queue_t *queue) {
 	uint64_t ret_val = 0;
-	if(queue != NULL) if(queue->end != NULL) ret_val = queue->end->size;
-	return ret_val;
-}
-uint64_t context_type(struct context_queue_t *queue) {
-	uint64_t ret_val = 0;
-	if(queue != NULL) if(queue->end != NULL) ret_val = queue->end->type;
+	if(queue != NULL) ret_val = queue->ring[atomic_load_explicit(&queue->tail, memory_order_relaxed) & queue->mask].read;
 	return ret_val;
 }
-
-/*void context_enqueue(struct context_queue_t *queue, struct context_element_t *element) {
-	if(queue != NULL && element != NULL) {
-		pthread_mutex_lock(&queue->lock);
-		element->next = queue->start;
-		if(queue->start != NULL) queue->start->back = element;
-		queue->start = element;
-		if(queue->end == NULL) queue->end = element;
-		pthread_mutex_unlock(&queue->lock);
-	}
-}*/
-char context_remove(struct context_queue_t *queue) {
+char context_failed(struct context_queue_t *queue) {
 	char ret_val = 0;
 	if(queue != NULL) {
-		pthread_mutex_lock(&queue->lock);
-		if(queue->end != NULL && queue->end->complete == 1) {
-			if(queue->end == queue->start) {
-				context_element_destroy(&queue->end);
-				queue->end = NULL;
-				queue->start = NULL;
-			} else {
-				queue->end = queue->end->back;
-				context_element_destroy(&queue->end->next);
-				queue->end->next = NULL;
-			}
-			ret_val = 1;
-		}
-		pthread_mutex_unlock(&queue->lock);
+		uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+		if(tail != atomic_load_explicit(&queue->head, memory_order_acquire)) ret_val = queue->ring[tail & queue->mask].failed;
 	}
 	return ret_val;
 }
-/*struct context_element_t *context_tail_peek(struct context_queue_t *queue) {
-	struct context_element_t *ret_val = NULL;
+uint64_t context_type(struct context_queue_t *queue) {
+	uint64_t ret_val = 0;
 	if(queue != NULL) {
-		pthread_mutex_lock(&queue->lock);
-		ret_val = queue->start;
-		pthread_mutex_unlock(&queue->lock);
+		uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+		if(tail != atomic_load_explicit(&queue->head, memory_order_acquire)) ret_val = queue->ring[tail & queue->mask].type;
 	}
 	return ret_val;
 }
 
-struct context_element_t *context_front_peek(struct context_queue_t *queue) {
-	struct context_element_t *ret_val = NULL;
+//Removes the oldest record if it is complete. Returns 1 if a record was removed.
+char context_remove(struct context_queue_t *queue) {
+	char ret_val = 0;
 	if(queue != NULL) {
-		pthread_mutex_lock(&queue->lock);
-		ret_val = queue->end;
-		pthread_mutex_unlock(&queue->lock);
-	}
-	return ret_val;
-}
+		uint64_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+		if(tail != atomic_load_explicit(&queue->head, memory_order_acquire)) {
 
-char context_is_complete(struct context_element_t *element) {
-	char ret_val = 0;
-	if(element != NULL) {
-		pthread_mutex_lock(&element->lock);
-		ret_val = element->complete;
-		pthread_mutex_unlock(&element->lock);
+			//Hand the record back to the parser for reuse.
+			atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+			ret_val = 1;
+		}
 	}
 	return ret_val;
 }
-void context_mark_complete(struct context_element_t *element) {
-	if(element != NULL) {
-		pthread_mutex_lock(&element->lock);
-		element->complete = 1;
-		pthread_mutex_unlock(&element->lock);
-	}
-}
-void context_increment(struct context_element_t *element, uint64_t sum) {
-	if(element != NULL) {
-		pthread_mutex_lock(&element->lock);
-		element->size += sum;
-		pthread_mutex_unlock(&element->lock);
-	}
-}*/
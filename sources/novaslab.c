@@ -0,0 +1,190 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novaslab.c
+Purpose: Hands out small objects of one size from caches kept by each thread, so that the pipeline's nodes are not taken from and given back to malloc one at a time, or freed across threads through it.
+*/
+
+//Necessary imports.
+#include"novaslab.h"
+#include<stdlib.h>
+
+//Bytes before an object, and before the first object carved from a block, which holds the block before it.
+#define SLAB_HEADER offsetof(struct slab_node_t, next)
+#define SLAB_CHUNK_HEADER sizeof(max_align_t)
+
+//Private functions.
+struct slab_magazine_t *slab_magazine(struct slab_t *);
+void slab_orphan(void *);
+struct slab_node_t *slab_refill(struct slab_t *, struct slab_magazine_t *);
+void slab_hand_on(struct slab_t *, struct slab_magazine_t *);
+uint64_t slab_stride(struct slab_t *);
+
+//Takes an object from the slab. The thread's own freed objects come first, then the ones other threads gave back to it, then a full magazine from the depot, and only then a new block.
+//Returns NULL if there is no memory for it.
+void *slab_alloc(struct slab_t *slab) {
+	struct slab_magazine_t *magazine = slab_magazine(slab);
+	if(magazine == NULL) return NULL;
+	struct slab_node_t *node = magazine->free;
+	if(node != NULL) {
+		magazine->free = node->next;
+		if(magazine->num_free > 0) --magazine->num_free;
+		atomic_fetch_add_explicit(&slab->recycled, 1, memory_order_relaxed);
+	} else if((node = slab_refill(slab, magazine)) == NULL) return NULL;
+	node->owner = magazine;
+
+	uint64_t live = atomic_fetch_add_explicit(&slab->live, 1, memory_order_relaxed) + 1;
+	uint64_t peak = atomic_load_explicit(&slab->peak, memory_order_relaxed);
+	while(live > peak && !atomic_compare_exchange_weak_explicit(&slab->peak, &peak, live, memory_order_relaxed, memory_order_relaxed));
+	return (char *)node + SLAB_HEADER;
+}
+
+//Gives an object back to the slab. An object taken by this thread goes on its own list, and one taken by another thread is pushed on that thread's remote list without a lock.
+void slab_free(struct slab_t *slab, void *object) {
+	if(object == NULL) return;
+	struct slab_node_t *node = (struct slab_node_t *)((char *)object - SLAB_HEADER);
+	struct slab_magazine_t *owner = node->owner;
+	atomic_fetch_sub_explicit(&slab->live, 1, memory_order_relaxed);
+	if(owner == slab_magazine(slab)) {
+		node->next = owner->free;
+		owner->free = node;
+		if(++owner->num_free >= SLAB_MAGAZINE_SIZE) slab_hand_on(slab, owner);
+	} else {
+		node->next = atomic_load_explicit(&owner->remote, memory_order_relaxed);
+		while(!atomic_compare_exchange_weak_explicit(&owner->remote, &node->next, node, memory_order_release, memory_order_relaxed));
+		atomic_fetch_add_explicit(&slab->remote_frees, 1, memory_order_relaxed);
+	}
+}
+
+//Frees every block, magazine and depot entry of the slab, with every object in them. Nothing may be using the slab, and it can be used again afterwards.
+void slab_release(struct slab_t *slab) {
+	pthread_mutex_lock(&slab->lock);
+	if(atomic_load_explicit(&slab->ready, memory_order_relaxed)) pthread_key_delete(slab->key);
+	atomic_store_explicit(&slab->ready, 0, memory_order_relaxed);
+	struct slab_depot_t *depot = atomic_load_explicit(&slab->depot, memory_order_relaxed);
+	while(depot != NULL) {
+		struct slab_depot_t *next = depot->next;
+		free(depot);
+		depot = next;
+	}
+	atomic_store_explicit(&slab->depot, NULL, memory_order_relaxed);
+	while(slab->magazines != NULL) {
+		struct slab_magazine_t *magazine = slab->magazines;
+		slab->magazines = magazine->next;
+		free(magazine);
+	}
+	while(slab->chunks != NULL) {
+		void *chunk = slab->chunks;
+		slab->chunks = *(void **)chunk;
+		free(chunk);
+	}
+	slab->orphans = NULL;
+	atomic_store_explicit(&slab->live, 0, memory_order_relaxed);
+	pthread_mutex_unlock(&slab->lock);
+}
+
+//Prints the counters of a slab.
+void slab_report(FILE *file, const char *name, struct slab_t *slab) {
+	if(file != NULL && slab != NULL) {
+		fprintf(file, "%s: live %lu, peak %lu, recycled %lu, remote frees %lu\n", name != NULL ? name : "slab",
+			(unsigned long)atomic_load_explicit(&slab->live, memory_order_relaxed),
+			(unsigned long)atomic_load_explicit(&slab->peak, memory_order_relaxed),
+			(unsigned long)atomic_load_explicit(&slab->recycled, memory_order_relaxed),
+			(unsigned long)atomic_load_explicit(&slab->remote_frees, memory_order_relaxed));
+	}
+}
+
+//Returns the magazine of the calling thread, making the slab's thread key first if no thread has yet. A thread without one takes a magazine left by a thread that ended, or a new one.
+//Returns NULL if there is no memory for it.
+struct slab_magazine_t *slab_magazine(struct slab_t *slab) {
+	if(!atomic_load_explicit(&slab->ready, memory_order_acquire)) {
+		pthread_mutex_lock(&slab->lock);
+		if(!atomic_load_explicit(&slab->ready, memory_order_relaxed) && pthread_key_create(&slab->key, slab_orphan) == 0) atomic_store_explicit(&slab->ready, 1, memory_order_release);
+		pthread_mutex_unlock(&slab->lock);
+		if(!atomic_load_explicit(&slab->ready, memory_order_acquire)) return NULL;
+	}
+	struct slab_magazine_t *ret_val = pthread_getspecific(slab->key);
+	if(ret_val == NULL) {
+		pthread_mutex_lock(&slab->lock);
+		if(slab->orphans != NULL) {
+			ret_val = slab->orphans;
+			slab->orphans = ret_val->next_orphan;
+		} else if((ret_val = calloc(1, sizeof(struct slab_magazine_t))) != NULL) {
+			atomic_init(&ret_val->remote, NULL);
+			ret_val->slab = slab;
+			ret_val->next = slab->magazines;
+			slab->magazines = ret_val;
+		}
+		pthread_mutex_unlock(&slab->lock);
+		if(ret_val != NULL) pthread_setspecific(slab->key, ret_val);
+	}
+	return ret_val;
+}
+
+//Leaves the magazine of a thread that is ending to the next thread that needs one. Objects other threads free to it still go on its remote list in the meantime.
+void slab_orphan(void *magazine_ptr) {
+	struct slab_magazine_t *magazine = (struct slab_magazine_t *)magazine_ptr;
+	struct slab_t *slab = magazine->slab;
+	pthread_mutex_lock(&slab->lock);
+	magazine->next_orphan = slab->orphans;
+	slab->orphans = magazine;
+	pthread_mutex_unlock(&slab->lock);
+}
+
+//Finds an object for a thread whose own list is empty, keeping the rest of what it finds on its list.
+//The thread's count of freed objects starts over, so that it only hands on objects once it has freed a magazine's worth itself.
+struct slab_node_t *slab_refill(struct slab_t *slab, struct slab_magazine_t *magazine) {
+	struct slab_node_t *ret_val = atomic_exchange_explicit(&magazine->remote, NULL, memory_order_acquire);
+	if(ret_val == NULL && atomic_load_explicit(&slab->depot, memory_order_relaxed) != NULL) {
+		pthread_mutex_lock(&slab->lock);
+		struct slab_depot_t *depot = atomic_load_explicit(&slab->depot, memory_order_relaxed);
+		if(depot != NULL) atomic_store_explicit(&slab->depot, depot->next, memory_order_relaxed);
+		pthread_mutex_unlock(&slab->lock);
+		if(depot != NULL) {
+			ret_val = depot->free;
+			free(depot);
+		}
+	}
+	if(ret_val != NULL) {
+		magazine->free = ret_val->next;
+		magazine->num_free = 0;
+		atomic_fetch_add_explicit(&slab->recycled, 1, memory_order_relaxed);
+		return ret_val;
+	}
+
+	//Nothing was freed, so the object is carved from the thread's block, or from a new one once it is used up.
+	uint64_t stride = slab_stride(slab);
+	if(magazine->carve == magazine->carve_end) {
+		char *chunk = malloc(SLAB_CHUNK_HEADER + stride * SLAB_CHUNK_OBJECTS);
+		if(chunk == NULL) return NULL;
+		pthread_mutex_lock(&slab->lock);
+		*(void **)chunk = slab->chunks;
+		slab->chunks = chunk;
+		pthread_mutex_unlock(&slab->lock);
+		magazine->carve = chunk + SLAB_CHUNK_HEADER;
+		magazine->carve_end = magazine->carve + stride * SLAB_CHUNK_OBJECTS;
+	}
+	ret_val = (struct slab_node_t *)magazine->carve;
+	magazine->carve += stride;
+	return ret_val;
+}
+
+//Hands the objects a thread has freed on to the depot as a full magazine, for a thread that frees more than it takes. They stay with the thread if there is no memory for the depot entry.
+void slab_hand_on(struct slab_t *slab, struct slab_magazine_t *magazine) {
+	struct slab_depot_t *depot = malloc(sizeof(struct slab_depot_t));
+	if(depot != NULL) {
+		depot->free = magazine->free;
+		pthread_mutex_lock(&slab->lock);
+		depot->next = atomic_load_explicit(&slab->depot, memory_order_relaxed);
+		atomic_store_explicit(&slab->depot, depot, memory_order_relaxed);
+		pthread_mutex_unlock(&slab->lock);
+		magazine->free = NULL;
+		magazine->num_free = 0;
+	}
+}
+
+//Returns the bytes each object takes with its header, which keeps every header aligned for any type.
+uint64_t slab_stride(struct slab_t *slab) {
+	uint64_t size = SLAB_HEADER + (slab->size > sizeof(struct slab_node_t *) ? slab->size : sizeof(struct slab_node_t *));
+	return (size + sizeof(max_align_t) - 1) / sizeof(max_align_t) * sizeof(max_align_t);
+}
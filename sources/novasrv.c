@@ -0,0 +1,307 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novasrv.c
+Purpose: Serves Nova sessions over a Unix domain socket. One epoll set holds every connection, and a fixed pool of workers steps the pipelines of whichever sessions are ready.
+*/
+
+//Necessary imports.
+#define _GNU_SOURCE
+#include"novasrv.h"
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<errno.h>
+#include<unistd.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<sys/epoll.h>
+#include<sys/eventfd.h>
+
+//Private functions.
+void server_accept(struct server_t *);
+void server_serve(struct server_t *, struct session_t *);
+void server_remove(struct server_t *, struct session_t *);
+char session_pump(struct session_t *, char *);
+int session_read(struct session_t *);
+int session_write(struct session_t *);
+
+//Create a server listening on a Unix domain socket at the given path, which replaces any socket left there. Each session gets buffers of the given size, and writes results in the given format.
+//Returns NULL if the socket cannot be set up.
+struct server_t *server_create(const char *path, uint64_t buffer_size, char format, int num_workers) {
+	struct server_t *ret_val = NULL;
+	if(path != NULL && strlen(path) < SERVER_PATH_SIZE && num_workers > 0) ret_val = malloc(sizeof(struct server_t));
+	if(ret_val != NULL) {
+		ret_val->buffer_size = buffer_size;
+		ret_val->format = format;
+		ret_val->num_workers = num_workers;
+		ret_val->workers = malloc(sizeof(pthread_t) * num_workers);
+		ret_val->started = 0;
+		pthread_mutex_init(&ret_val->lock, NULL);
+		ret_val->sessions = NULL;
+		ret_val->num_sessions = 0;
+		strcpy(ret_val->path, path);
+
+		//Set up the listening socket, the epoll set, and the event that stops the workers.
+		struct sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strcpy(address.sun_path, path);
+		unlink(path);
+		ret_val->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		ret_val->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		ret_val->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		char valid = ret_val->workers != NULL && ret_val->listen_fd != -1 && ret_val->epoll_fd != -1 && ret_val->stop_fd != -1;
+		valid = valid && bind(ret_val->listen_fd, (struct sockaddr *)&address, sizeof(address)) == 0 && listen(ret_val->listen_fd, SERVER_BACKLOG) == 0;
+
+		//The listening socket is handed to one worker at a time. The stop event is left set once raised, so that it reaches every worker.
+		struct epoll_event event;
+		event.events = EPOLLIN | EPOLLONESHOT;
+		event.data.ptr = &ret_val->listen_fd;
+		valid = valid && epoll_ctl(ret_val->epoll_fd, EPOLL_CTL_ADD, ret_val->listen_fd, &event) == 0;
+		event.events = EPOLLIN;
+		event.data.ptr = &ret_val->stop_fd;
+		valid = valid && epoll_ctl(ret_val->epoll_fd, EPOLL_CTL_ADD, ret_val->stop_fd, &event) == 0;
+		if(!valid) server_destroy(&ret_val);
+	}
+	return ret_val;
+}
+
+//Deallocate a server, closing every session still open and removing the socket. The workers must have been stopped.
+void server_destroy(struct server_t **server) {
+	if(server != NULL) {
+		if(*server != NULL) {
+			while((*server)->sessions != NULL) server_remove(*server, (*server)->sessions);
+			if((*server)->listen_fd != -1) {
+				close((*server)->listen_fd);
+				unlink((*server)->path);
+			}
+			if((*server)->epoll_fd != -1) close((*server)->epoll_fd);
+			if((*server)->stop_fd != -1) close((*server)->stop_fd);
+			pthread_mutex_destroy(&(*server)->lock);
+			if((*server)->workers != NULL) free((*server)->workers);
+			free(*server);
+			*server = NULL;
+		}
+	}
+}
+
+//Starts the workers. Returns 1 if all of them started. Those that did are stopped by server_stop either way.
+char server_start(struct server_t *server) {
+	char ret_val = 0;
+	if(server != NULL) {
+		while(server->started < server->num_workers && pthread_create(&server->workers[server->started], NULL, do_serve, (void *)server) == 0) ++server->started;
+		ret_val = server->started == server->num_workers;
+	}
+	return ret_val;
+}
+
+//Stops the workers and waits for them. Sessions are left open until the server is destroyed.
+void server_stop(struct server_t *server) {
+	if(server != NULL) {
+		uint64_t one = 1;
+		if(write(server->stop_fd, &one, sizeof(one)) != sizeof(one)) perror("server_stop");
+		for(int i = 0; i < server->started; ++i) pthread_join(server->workers[i], NULL);
+		server->started = 0;
+	}
+}
+
+//Serves sessions until the server is stopped. Each worker takes one ready connection at a time, and the epoll set hands a connection to only one worker until it is armed again.
+void *do_serve(void *server_ptr) {
+	if(server_ptr != NULL) {
+		struct server_t *server = (struct server_t *)server_ptr;
+		struct epoll_event event;
+		while(1) {
+			int count = epoll_wait(server->epoll_fd, &event, 1, -1);
+			if(count < 0 && errno == EINTR) continue;
+			if(count < 0 || event.data.ptr == &server->stop_fd) break;
+			if(event.data.ptr == &server->listen_fd) server_accept(server);
+			else server_serve(server, (struct session_t *)event.data.ptr);
+		}
+	}
+	return NULL;
+}
+
+//Accepts every waiting connection, then hands the listening socket back.
+void server_accept(struct server_t *server) {
+	int fd = -1;
+	while((fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1 || errno == EINTR || errno == ECONNABORTED) {
+		if(fd == -1) continue;
+		struct session_t *session = session_create(fd, server->buffer_size, server->format);
+		if(session == NULL) {
+			close(fd);
+			continue;
+		}
+
+		//List the session before arming it, as another worker may take it straight away.
+		pthread_mutex_lock(&server->lock);
+		session->next = server->sessions;
+		if(server->sessions != NULL) server->sessions->prev = session;
+		server->sessions = session;
+		++server->num_sessions;
+		pthread_mutex_unlock(&server->lock);
+		struct epoll_event event;
+		event.events = EPOLLIN | EPOLLONESHOT;
+		event.data.ptr = session;
+		if(epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) server_remove(server, session);
+	}
+	struct epoll_event event;
+	event.events = EPOLLIN | EPOLLONESHOT;
+	event.data.ptr = &server->listen_fd;
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, server->listen_fd, &event);
+}
+
+//Moves a session along as far as it will go, then arms it again for whatever it is waiting on, or closes it once it is done.
+void server_serve(struct server_t *server, struct session_t *session) {
+	char yielded = 0;
+	if(!session_pump(session, &yielded)) server_remove(server, session);
+	else {
+
+		//Wait for input only while there is room for it, and for the socket to drain only while there is output.
+		//A session that gave up its worker with work left asks for output too, which a connected socket is almost always ready for, so that it comes straight back.
+		//So does a session left waiting on neither, as when its input is full or over and its results are still on the way, since nothing else would ever hand it to a worker again.
+		struct epoll_event event;
+		event.events = EPOLLONESHOT;
+		if(session->input_state == SESSION_INPUT_OPEN && buffer_try_reserve(session->in_buf, 1) != NULL) event.events |= EPOLLIN;
+		if(yielded || buffer_try_peek(session->out_buf) != NULL || !(event.events & EPOLLIN)) event.events |= EPOLLOUT;
+		event.data.ptr = session;
+		if(epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, session->fd, &event) != 0) server_remove(server, session);
+	}
+}
+
+//Closes a session and frees it.
+void server_remove(struct server_t *server, struct session_t *session) {
+	pthread_mutex_lock(&server->lock);
+	if(session->prev != NULL) session->prev->next = session->next;
+	else server->sessions = session->next;
+	if(session->next != NULL) session->next->prev = session->prev;
+	--server->num_sessions;
+	pthread_mutex_unlock(&server->lock);
+	session_destroy(&session);
+}
+
+//Create a session for a connected socket, with a pipeline of its own that writes results in the given format. Takes over the socket on success.
+struct session_t *session_create(int fd, uint64_t buffer_size, char format) {
+	struct session_t *ret_val = malloc(sizeof(struct session_t));
+	if(ret_val != NULL) {
+		ret_val->fd = fd;
+		ret_val->in_buf = buffer_create_mirror(buffer_size);
+		ret_val->parse_buf = buffer_create_mirror(buffer_size);
+		ret_val->out_buf = buffer_create_mirror(buffer_size);
+		ret_val->context_queue = context_queue_create();
+		ret_val->execute_stack = execute_stack_create_array(0);
+		ret_val->parse = parse_create();
+		ret_val->interpret = interpret_create();
+		ret_val->execute = execute_create();
+		ret_val->input_state = SESSION_INPUT_OPEN;
+		ret_val->last = '\0';
+		ret_val->prev = NULL;
+		ret_val->next = NULL;
+
+		//Make session creation atomic, but leave the socket to the caller.
+		if(ret_val->in_buf == NULL || ret_val->parse_buf == NULL || ret_val->out_buf == NULL || ret_val->context_queue == NULL || ret_val->execute_stack == NULL || ret_val->parse == NULL || ret_val->interpret == NULL || ret_val->execute == NULL) {
+			ret_val->fd = -1;
+			session_destroy(&ret_val);
+		} else {
+
+			//Wire up the pipeline the same way as the one run from standard input.
+			parse_set_in(ret_val->parse, ret_val->in_buf);
+			parse_set_out(ret_val->parse, ret_val->parse_buf);
+			parse_set_queue(ret_val->parse, ret_val->context_queue);
+			interpret_set_in(ret_val->interpret, ret_val->parse_buf);
+			interpret_set_queue(ret_val->interpret, ret_val->context_queue);
+			interpret_set_stack(ret_val->interpret, ret_val->execute_stack);
+			execute_set_stack(ret_val->execute, ret_val->execute_stack);
+			execute_set_out(ret_val->execute, ret_val->out_buf);
+			execute_set_format(ret_val->execute, format);
+		}
+	}
+	return ret_val;
+}
+
+//Deallocate a session and close its socket, which also takes it out of the epoll set.
+void session_destroy(struct session_t **session) {
+	if(session != NULL) {
+		if(*session != NULL) {
+			if((*session)->fd != -1) close((*session)->fd);
+			parse_destroy(&(*session)->parse);
+			interpret_destroy(&(*session)->interpret);
+			execute_destroy(&(*session)->execute);
+			buffer_destroy(&(*session)->in_buf);
+			buffer_destroy(&(*session)->parse_buf);
+			buffer_destroy(&(*session)->out_buf);
+			context_queue_destroy(&(*session)->context_queue);
+			execute_stack_destroy(&(*session)->execute_stack);
+			free(*session);
+			*session = NULL;
+		}
+	}
+}
+
+//Reads from the socket, steps each stage, and writes results back, until nothing moves or the pass budget runs out, in which case yielded is set.
+//Returns 0 once the session is over: the client has stopped sending and every result has been written, or the connection has failed.
+char session_pump(struct session_t *session, char *yielded) {
+	char progress = 1;
+	char failed = 0;
+	int passes = 0;
+	while(progress && !failed && passes < SERVER_SESSION_PASSES) {
+		int received = session_read(session);
+		progress = received > 0;
+		progress |= fuse_step(session->parse, session->interpret, session->execute);
+		progress |= parse_step(session->parse);
+		progress |= interpret_step(session->interpret);
+		progress |= execute_step(session->execute);
+		int written = session_write(session);
+		progress |= written > 0;
+		failed = received < 0 || written < 0;
+		++passes;
+	}
+	*yielded = progress && !failed;
+	return !failed && (session->execute->cont_flag || buffer_try_peek(session->out_buf) != NULL);
+}
+
+//Reads what the socket has into the input buffer. Once the client stops sending, ends a last statement left without a line end and closes the input.
+//Returns 1 on progress, 0 if there was nothing to do, and -1 if the connection failed.
+int session_read(struct session_t *session) {
+	int ret_val = 0;
+	char *cursor = NULL;
+	if(session->input_state == SESSION_INPUT_OPEN) {
+		cursor = buffer_try_reserve(session->in_buf, 1);
+		if(cursor != NULL) {
+			ssize_t count = read(session->fd, cursor, buffer_write_span(session->in_buf));
+			if(count > 0) {
+				session->last = cursor[count - 1];
+				buffer_commit(session->in_buf, count);
+				ret_val = 1;
+			} else if(count == 0) {
+				session->input_state = SESSION_INPUT_EOF;
+				ret_val = 1;
+			} else if(errno != EAGAIN && errno != EINTR) ret_val = -1;
+		}
+	} else if(session->input_state == SESSION_INPUT_EOF) {
+		if(session->last != '\0' && session->last != '\n' && session->last != '\r' && (cursor = buffer_try_reserve(session->in_buf, 1)) != NULL) {
+			*cursor = '\0';
+			buffer_commit(session->in_buf, 1);
+			session->last = '\0';
+		}
+		if(session->last == '\0' || session->last == '\n' || session->last == '\r') {
+			buffer_close(session->in_buf);
+			session->input_state = SESSION_INPUT_CLOSED;
+			ret_val = 1;
+		}
+	}
+	return ret_val;
+}
+
+//Writes what results there are back to the socket. Returns 1 on progress, 0 if there was nothing to do or no room, and -1 if the connection failed.
+int session_write(struct session_t *session) {
+	int ret_val = 0;
+	if(buffer_try_peek(session->out_buf) != NULL) {
+		ssize_t count = send(session->fd, session->out_buf->cursor_read, buffer_read_span(session->out_buf), MSG_NOSIGNAL);
+		if(count > 0) {
+			buffer_consume(session->out_buf, count);
+			ret_val = 1;
+		} else if(count < 0 && errno != EAGAIN && errno != EINTR) ret_val = -1;
+	}
+	return ret_val;
+}
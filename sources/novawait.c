@@ -0,0 +1,174 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novawait.c
+Purpose: To implement the waiting policy for the pipeline. A waiter spins with a pause instruction for a self-tuning number of iterations, then yields, then parks on a futex.
+*/
+
+//Necessary imports.
+#define _GNU_SOURCE
+#include"novawait.h"
+#include<limits.h>
+#include<sched.h>
+#include<unistd.h>
+#include<time.h>
+#include<linux/futex.h>
+#include<sys/syscall.h>
+
+//Private functions.
+void wait_cpu_pause();
+uint32_t wait_spin_max();
+
+//Initializes a waiting site.
+void wait_init(struct wait_t *wait) {
+	if(wait != NULL) {
+		atomic_init(&wait->futex, 0);
+		atomic_init(&wait->parked, 0);
+		atomic_init(&wait->spin_limit, wait_spin_max() < WAIT_SPIN_MIN ? 0 : WAIT_SPIN_MIN);
+		for(int i = 0; i < WAIT_NUM_PHASES; ++i) atomic_init(&wait->resolved[i], 0);
+		wait->shared = 0;
+	}
+}
+
+//Initializes a waiting site that may be shared between processes.
+void wait_init_shared(struct wait_t *wait) {
+	if(wait != NULL) {
+		wait_init(wait);
+		wait->shared = 1;
+	}
+}
+
+//Runs the spin and the yield phases. Returns 1 if the waiter can continue, or 0 if it should park.
+//The spin limit moves toward twice the number of iterations that successful spins needed, and decays whenever spinning fails.
+char wait_spin(struct wait_t *wait, wait_ready_t ready, void *arg) {
+	uint32_t limit = atomic_load_explicit(&wait->spin_limit, memory_order_relaxed);
+	uint32_t max = wait_spin_max();
+	uint32_t count = 0;
+
+	//Spin phase.
+	for(; count < limit; ++count) {
+		wait_cpu_pause();
+		if(ready(arg)) {
+			uint32_t target = count * 2 + WAIT_SPIN_MIN;
+			if(target > max) target = max;
+			atomic_store_explicit(&wait->spin_limit, limit + ((int32_t)target - (int32_t)limit) / 8, memory_order_relaxed);
+			wait_count(wait, WAIT_PHASE_SPIN);
+			return 1;
+		}
+	}
+	if(limit > WAIT_SPIN_MIN) atomic_store_explicit(&wait->spin_limit, limit - limit / 8, memory_order_relaxed);
+
+	//Yield phase.
+	for(count = 0; count < WAIT_YIELD_ROUNDS; ++count) {
+		sched_yield();
+		if(ready(arg)) {
+			wait_count(wait, WAIT_PHASE_YIELD);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//Runs the park phase. Sleeps on the futex until the check passes.
+void wait_park(struct wait_t *wait, wait_ready_t ready, void *arg) {
+	uint32_t ticket = 0;
+	while(1) {
+
+		//Take a ticket and announce the sleep before checking again, so that the waking side either sees the flag or the waiter sees the work.
+		ticket = atomic_load_explicit(&wait->futex, memory_order_acquire);
+		atomic_store_explicit(&wait->parked, 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		if(ready(arg)) break;
+
+		//Sleep unless the ticket has already moved on.
+		syscall(SYS_futex, &wait->futex, wait->shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, ticket, NULL, NULL, 0);
+	}
+	atomic_store_explicit(&wait->parked, 0, memory_order_relaxed);
+	wait_count(wait, WAIT_PHASE_PARK);
+}
+
+//Waits until the check passes.
+void wait_for(struct wait_t *wait, wait_ready_t ready, void *arg) {
+	if(!wait_spin(wait, ready, arg)) wait_park(wait, ready, arg);
+}
+
+//Waits until the check passes or the given number of nanoseconds has gone by, parking straight away. Returns 1 if the check passed.
+//For waiters that would rather go on with what they have than wait long, so spinning is not worth it.
+char wait_for_timed(struct wait_t *wait, wait_ready_t ready, void *arg, uint64_t ns) {
+	char ret_val = 0;
+	uint32_t ticket = 0;
+	struct timespec now, left;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t deadline = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec + ns;
+	while(1) {
+
+		//Same handshake as wait_park.
+		ticket = atomic_load_explicit(&wait->futex, memory_order_acquire);
+		atomic_store_explicit(&wait->parked, 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_seq_cst);
+		if(ready(arg)) {
+			ret_val = 1;
+			break;
+		}
+
+		//Sleep for whatever is left of the time.
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		uint64_t current = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+		if(current >= deadline) break;
+		left.tv_sec = (deadline - current) / 1000000000ULL;
+		left.tv_nsec = (deadline - current) % 1000000000ULL;
+		syscall(SYS_futex, &wait->futex, wait->shared ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE, ticket, &left, NULL, 0);
+	}
+	atomic_store_explicit(&wait->parked, 0, memory_order_relaxed);
+	if(ret_val) wait_count(wait, WAIT_PHASE_PARK);
+	return ret_val;
+}
+
+//Wakes a parked waiter. Must be called after the work it waits for has been published. Costs only a fence when nobody is parked.
+//Returns 1 if a wake was sent.
+char wait_wake(struct wait_t *wait) {
+	char ret_val = 0;
+	atomic_thread_fence(memory_order_seq_cst);
+	if(atomic_load_explicit(&wait->parked, memory_order_relaxed)) {
+		atomic_fetch_add_explicit(&wait->futex, 1, memory_order_release);
+		syscall(SYS_futex, &wait->futex, wait->shared ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+		ret_val = 1;
+	}
+	return ret_val;
+}
+
+//Records that a wait was resolved in the given phase. Used directly by waiters that park by other means.
+void wait_count(struct wait_t *wait, char phase) {
+	atomic_fetch_add_explicit(&wait->resolved[(int)phase], 1, memory_order_relaxed);
+}
+
+//Prints how often each phase resolved the waits on a site.
+void wait_report(FILE *file, const char *name, struct wait_t *wait) {
+	if(file != NULL && wait != NULL) {
+		fprintf(file, "%s: spin %lu, yield %lu, park %lu, spin limit %u\n", name != NULL ? name : "wait",
+			(unsigned long)atomic_load_explicit(&wait->resolved[WAIT_PHASE_SPIN], memory_order_relaxed),
+			(unsigned long)atomic_load_explicit(&wait->resolved[WAIT_PHASE_YIELD], memory_order_relaxed),
+			(unsigned long)atomic_load_explicit(&wait->resolved[WAIT_PHASE_PARK], memory_order_relaxed),
+			atomic_load_explicit(&wait->spin_limit, memory_order_relaxed));
+	}
+}
+
+//Issues the processor's spin-wait hint.
+void wait_cpu_pause() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+//Returns the most iterations a waiter may spin. Spinning is pointless with a single processor, since the other side cannot run meanwhile.
+uint32_t wait_spin_max() {
+	static _Atomic uint32_t max = UINT32_MAX;
+	uint32_t ret_val = atomic_load_explicit(&max, memory_order_relaxed);
+	if(ret_val == UINT32_MAX) {
+		ret_val = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? WAIT_SPIN_MAX : 0;
+		atomic_store_explicit(&max, ret_val, memory_order_relaxed);
+	}
+	return ret_val;
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+#Runs scripts larger than the session buffers through nova --listen, and checks the results against the same scripts run from standard input.
+#Usage: listen.sh nova novasock
+
+nova=$1
+client=$2
+dir=$(mktemp -d)
+server=
+trap '[ -n "$server" ] && kill $server 2>/dev/null; rm -rf "$dir"' EXIT
+status=0
+
+#Well formed statements, and the same with every seventh line missing its statement end. Both run to several times the largest buffer size tried.
+awk 'BEGIN { for(i = 0; i < 20000; ++i) printf "%d+%d-%d;\n", (i * 7919) % 100000, (i * 104729) % 1000000, i % 1000 }' > "$dir/plain.nv"
+awk '{ if(NR % 7 == 0) sub(/;$/, ""); print }' "$dir/plain.nv" > "$dir/open.nv"
+
+for size in 1024 65536; do
+	for script in plain open; do
+		"$nova" --listen="$dir/nova.sock" --buffer-size=$size --workers=2 > /dev/null 2>&1 &
+		server=$!
+		tries=0
+		while [ ! -S "$dir/nova.sock" ] && [ $tries -lt 50 ]; do
+			sleep 0.1
+			tries=$((tries + 1))
+		done
+
+		"$nova" --buffer-size=$size < "$dir/$script.nv" | grep -v -e '^$' -e '^Nova ' > "$dir/expected"
+		if "$client" "$dir/nova.sock" < "$dir/$script.nv" > "$dir/actual" && cmp -s "$dir/expected" "$dir/actual"; then
+			echo "listen: $script.nv with --buffer-size=$size: ok"
+		else
+			echo "listen: $script.nv with --buffer-size=$size: FAILED ($(wc -c < "$dir/actual") of $(wc -c < "$dir/expected") bytes)"
+			status=1
+		fi
+		kill $server
+		wait $server
+		server=
+		rm -f "$dir/nova.sock"
+	done
+done
+exit $status
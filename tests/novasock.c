@@ -0,0 +1,91 @@
+/*
+Author: agent
+Date: 10.18.2026
+File: novasock.c
+Purpose: Test client for a Nova server on a Unix domain socket. Sends standard input to one session and writes the results it gets back to standard output.
+*/
+
+//Necessary imports.
+#include<stdio.h>
+#include<string.h>
+#include<errno.h>
+#include<unistd.h>
+#include<poll.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+
+//Bytes moved at a time, and how long the client waits for the server to move before it gives up, in milliseconds.
+#define SOCK_CHUNK 4096
+#define SOCK_TIMEOUT_MS 10000
+
+//Connects to the socket at the path given, then sends and receives at the same time, as a session only takes more input once its results have been read.
+//Returns 0 once the server has closed the session, and 1 if the server stops moving or the connection fails.
+int main(int argc, char **argv) {
+	if(argc != 2 || strlen(argv[1]) >= sizeof(((struct sockaddr_un *)NULL)->sun_path)) {
+		fprintf(stderr, "Usage: %s socket\n", argv[0]);
+		return 1;
+	}
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, argv[1]);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd == -1 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+		perror("novasock");
+		return 1;
+	}
+
+	char in[SOCK_CHUNK];
+	char out[SOCK_CHUNK];
+	ssize_t in_size = 0;
+	ssize_t in_sent = 0;
+	char in_open = 1;
+	size_t received = 0;
+	while(1) {
+
+		//Standard input is only read once what was read before has been sent.
+		struct pollfd fds[2];
+		fds[0].fd = fd;
+		fds[0].events = POLLIN | (in_sent < in_size ? POLLOUT : 0);
+		fds[1].fd = in_open && in_sent == in_size ? STDIN_FILENO : -1;
+		fds[1].events = POLLIN;
+		int ready = poll(fds, 2, SOCK_TIMEOUT_MS);
+		if(ready < 0 && errno == EINTR) continue;
+		if(ready <= 0) {
+			if(ready == 0) fprintf(stderr, "novasock: the server stopped after %zu bytes of results\n", received);
+			else perror("novasock");
+			return 1;
+		}
+
+		//At the end of standard input, tell the server nothing more is coming.
+		if(fds[1].revents != 0) {
+			in_size = read(STDIN_FILENO, in, sizeof(in));
+			in_sent = 0;
+			if(in_size <= 0) {
+				in_size = 0;
+				in_open = 0;
+				shutdown(fd, SHUT_WR);
+			}
+		}
+		if(fds[0].revents & POLLOUT) {
+			ssize_t count = send(fd, in + in_sent, in_size - in_sent, MSG_NOSIGNAL);
+			if(count < 0 && errno != EAGAIN && errno != EINTR) {
+				perror("novasock");
+				return 1;
+			} else if(count > 0) in_sent += count;
+		}
+		if(fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+			ssize_t count = read(fd, out, sizeof(out));
+			if(count == 0) break;
+			if(count < 0 && errno != EAGAIN && errno != EINTR) {
+				perror("novasock");
+				return 1;
+			} else if(count > 0) {
+				fwrite(out, 1, count, stdout);
+				received += count;
+			}
+		}
+	}
+	close(fd);
+	return 0;
+}
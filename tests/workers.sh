@@ -0,0 +1,31 @@
+#!/bin/sh
+#Runs scripts with lines missing their statement end through nova in chunks with several worker counts, and checks the results against those of the single pipeline.
+#Usage: workers.sh nova
+
+nova=$1
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+status=0
+
+#Every other line is missing its statement end and every third ends in an operator, and the last line has no line end. The script is large enough to be cut into several chunks.
+awk 'BEGIN { for(i = 0; i < 20000; ++i) { line = sprintf("%d+%d-%d", (i * 7919) % 100000, (i * 104729) % 1000000, i % 1000); if(i % 3 == 0) line = line "+"; if(i % 2 == 0) line = line ";"; printf "%s\n", line } printf "5" }' > "$dir/open.nv"
+printf '1;\n5\n' > "$dir/short.nv"
+
+for script in open short; do
+	"$nova" < "$dir/$script.nv" > "$dir/expected" 2> /dev/null
+	for workers in 2 3 8; do
+		if "$nova" --workers=$workers "$dir/$script.nv" > "$dir/actual" 2> /dev/null && cmp -s "$dir/expected" "$dir/actual"; then
+			echo "workers: $script.nv with --workers=$workers: ok"
+		else
+			echo "workers: $script.nv with --workers=$workers: FAILED"
+			status=1
+		fi
+	done
+done
+
+#The last line is given a result whether or not it has a line end.
+if [ "$(grep -c -v -e '^$' -e '^Nova ' "$dir/expected")" -ne 2 ]; then
+	echo "workers: short.nv is missing its last result"
+	status=1
+fi
+exit $status